@@ -5,10 +5,20 @@
 #include <stdbool.h>
 #include <unistd.h> // for read
 #include <pthread.h>
+#include <time.h>
 #define MAX_THREADS 8
 
 //#include <openssl/sha.h> // needs -lcrypto
-#include <CommonCrypto/CommonDigest.h>
+#ifdef __APPLE__
+  #include <CommonCrypto/CommonDigest.h>
+#else
+  #include "sha1.h"
+  #define CC_SHA1_CTX SHA1_CTX
+  #define CC_SHA1_Init SHA1_Init
+  #define CC_SHA1_Update SHA1_Update
+  #define CC_SHA1_Final SHA1_Final
+  #define CC_SHA1_DIGEST_LENGTH SHA1_DIGEST_LENGTH
+#endif
 #ifndef SHA_DIGEST_LENGTH
   #define SHA_DIGEST_LENGTH CC_SHA1_DIGEST_LENGTH
 #endif
@@ -19,6 +29,7 @@ int headerLen, commitLen, messageLen, dateLen, authOffset, commOffset, authDate,
 char message[MAX_MESSAGE];
 unsigned char hexMessage[MAX_MESSAGE/2];
 bool dry_run = false;
+int bench = 0; // hash this many candidates without matching, then report
 volatile bool found = false;
 int count=0;
 CC_SHA1_CTX gctx;
@@ -77,12 +88,11 @@ char* getCommit() {
   int headlen = strlen(header);
   len += headlen+1;
 
-  char * commit = malloc(len+2);
+  char * commit = malloc(len+1);
   memcpy(commit, header, headlen);
-  commit[headlen+1] = '\0';
-  memcpy(commit+headlen+1, commitbuff, len);
-  commit[len+1] = '\n';
-  commit[len+2] = '\0';
+  commit[headlen] = '\0';
+  memcpy(commit+headlen+1, commitbuff, len-headlen-1);
+  commit[len] = '\0';
 
   return commit;
 }
@@ -189,8 +199,8 @@ void ammend_commit(char *newCommit, unsigned char *sha, int da, int dc) {
 
   fp = popen("git hash-object -t commit /tmp/commit", "r");
   if (fp == NULL) { puts("Failed to run git hash-object"); exit(1); }
-  char gitHash[SHA_DIGEST_LENGTH*2+1] = "";
-  while (fgets(gitHash, 80, fp) != NULL) { }
+  char gitHash[SHA_DIGEST_LENGTH*2+2] = ""; // the id, its newline and the nul
+  while (fgets(gitHash, sizeof gitHash, fp) != NULL) { }
   gitHash[SHA_DIGEST_LENGTH*2] = '\0';
   pclose(fp);
 
@@ -240,12 +250,12 @@ void *Search(void* argsptr){
 
   char newCommit[commitLen+1];
   memcpy(newCommit,args.commit,commitLen);
-  newCommit[commitLen+1]='\0';
+  newCommit[commitLen]='\0';
 
   unsigned char hash[SHA_DIGEST_LENGTH];
 
   int da, dc;
-  int max = spiral_max(3600);
+  int max = bench ? bench+1 : spiral_max(3600);
 
   const void * newCommitPartial = newCommit+authOffset;
   int commitLenParital = commitLen-authOffset;
@@ -261,7 +271,7 @@ void *Search(void* argsptr){
     CC_SHA1_Update(&ctx, newCommitPartial, commitLenParital);
     CC_SHA1_Final(hash, &ctx);
 
-    if (shacmp(hash)) {
+    if (!bench && shacmp(hash)) {
       if (found) { return NULL; } //another thread beat us
       found = true;
       ammend_commit(newCommit, hash, da, dc);
@@ -272,16 +282,11 @@ void *Search(void* argsptr){
 
 int main(int argc, char *argv[]) {
   for(int i = 0; i < MAX_MESSAGE; i++) { message[i] = '\0'; }
-  if (argc==2) {
-    if (!strncmp(argv[1], "--dry-run", sizeof("--dry-run"))) { dry_run = true; }
-    else { strlcpy(message, argv[1], MAX_MESSAGE); }
-  } else if (argc==3) {
-    strlcpy(message, argv[1], MAX_MESSAGE);
-    if (!strncmp(argv[2], "--dry-run", sizeof("--dry-run"))) { dry_run = true; }
-    else { puts("incorrect arguments"); exit(1); }
-  } else if (argc>3) {
-    puts("too many arguments");
-    exit(1);
+  for(int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--dry-run")) { dry_run = true; }
+    else if (!strcmp(argv[i], "--bench") && i+1 < argc) { bench = atoi(argv[++i]); dry_run = true; }
+    else if (message[0] == '\0') { snprintf(message, MAX_MESSAGE, "%s", argv[i]); }
+    else { puts("too many arguments"); exit(1); }
   }
 
   if (message[0] == '\0') { setFromGitConfig(message); }
@@ -319,7 +324,10 @@ int main(int argc, char *argv[]) {
 
   // printf("a: %d, o: %d, ad: %d, od: %d\n", authOffset, commOffset, authDate, commDate);
   // printf("args: %d, message: %s, dry: %d \n", argc, message, dry_run);
-  printf("searching for: %s\n", message);
+  if (!bench) { printf("searching for: %s\n", message); }
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
 
   pthread_t threads[MAX_THREADS+1];
   searchArgs thread_args[MAX_THREADS];
@@ -328,11 +336,17 @@ int main(int argc, char *argv[]) {
     thread_args[i] = args;
     pthread_create(&threads[i], NULL, Search, (void *) &thread_args[i]);
   }
-  pthread_create(&threads[MAX_THREADS], NULL, Display, NULL);
+  if (!bench) { pthread_create(&threads[MAX_THREADS], NULL, Display, NULL); }
   for(int i=0; i<MAX_THREADS; i++) {
     pthread_join(threads[i], NULL);
   }
 
+  if (bench) {
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("c-baseline: %d hashes, %0.3fs, %0.1f Mh/s\n", bench, secs, bench / secs / 1e6);
+  }
+
   return 0;
 }
 
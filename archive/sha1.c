@@ -0,0 +1,78 @@
+#include <string.h>
+#include "sha1.h"
+
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void sha1_block(SHA1_CTX *ctx, const unsigned char *p) {
+  uint32_t w[80];
+  for (int i = 0; i < 16; i++) {
+    w[i] = (uint32_t)p[i*4] << 24 | (uint32_t)p[i*4+1] << 16 | (uint32_t)p[i*4+2] << 8 | p[i*4+3];
+  }
+  for (int i = 16; i < 80; i++) {
+    w[i] = ROL(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+  }
+
+  uint32_t a = ctx->h[0], b = ctx->h[1], c = ctx->h[2], d = ctx->h[3], e = ctx->h[4];
+  for (int i = 0; i < 80; i++) {
+    uint32_t f, k;
+    if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5a827999; }
+    else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ed9eba1; }
+    else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8f1bbcdc; }
+    else             { f = b ^ c ^ d;                   k = 0xca62c1d6; }
+    uint32_t t = ROL(a, 5) + f + e + k + w[i];
+    e = d; d = c; c = ROL(b, 30); b = a; a = t;
+  }
+
+  ctx->h[0] += a; ctx->h[1] += b; ctx->h[2] += c; ctx->h[3] += d; ctx->h[4] += e;
+}
+
+void SHA1_Init(SHA1_CTX *ctx) {
+  ctx->h[0] = 0x67452301;
+  ctx->h[1] = 0xefcdab89;
+  ctx->h[2] = 0x98badcfe;
+  ctx->h[3] = 0x10325476;
+  ctx->h[4] = 0xc3d2e1f0;
+  ctx->len = 0;
+  ctx->buf_len = 0;
+}
+
+void SHA1_Update(SHA1_CTX *ctx, const void *data, size_t len) {
+  const unsigned char *p = data;
+  ctx->len += len;
+
+  if (ctx->buf_len) {
+    size_t take = 64 - ctx->buf_len;
+    if (take > len) { take = len; }
+    memcpy(ctx->buf + ctx->buf_len, p, take);
+    ctx->buf_len += take;
+    p += take;
+    len -= take;
+    if (ctx->buf_len < 64) { return; }
+    sha1_block(ctx, ctx->buf);
+    ctx->buf_len = 0;
+  }
+
+  for (; len >= 64; p += 64, len -= 64) {
+    sha1_block(ctx, p);
+  }
+
+  memcpy(ctx->buf, p, len);
+  ctx->buf_len = len;
+}
+
+void SHA1_Final(unsigned char *out, SHA1_CTX *ctx) {
+  uint64_t bits = ctx->len * 8;
+  unsigned char pad[72] = { 0x80 };
+  size_t padlen = (ctx->buf_len < 56 ? 56 : 120) - ctx->buf_len;
+  for (int i = 0; i < 8; i++) {
+    pad[padlen+i] = bits >> (56 - i*8);
+  }
+  SHA1_Update(ctx, pad, padlen + 8);
+
+  for (int i = 0; i < 5; i++) {
+    out[i*4]   = ctx->h[i] >> 24;
+    out[i*4+1] = ctx->h[i] >> 16;
+    out[i*4+2] = ctx->h[i] >> 8;
+    out[i*4+3] = ctx->h[i];
+  }
+}
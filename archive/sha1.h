@@ -0,0 +1,22 @@
+// Portable SHA-1 for hosts without CommonCrypto, with the same calling
+// convention as CC_SHA1_* so git-vain.c doesn't care which one it gets.
+#ifndef GIT_VAIN_SHA1_H
+#define GIT_VAIN_SHA1_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA1_DIGEST_LENGTH 20
+
+typedef struct {
+  uint32_t h[5];
+  uint64_t len;
+  unsigned char buf[64];
+  size_t buf_len;
+} SHA1_CTX;
+
+void SHA1_Init(SHA1_CTX *ctx);
+void SHA1_Update(SHA1_CTX *ctx, const void *data, size_t len);
+void SHA1_Final(unsigned char *out, SHA1_CTX *ctx);
+
+#endif
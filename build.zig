@@ -15,6 +15,13 @@ pub fn build(b: *std.Build) void {
     // set a preferred release mode, allowing the user to decide how to optimize.
     const optimize = b.standardOptimizeOption(.{});
 
+    // Everything links libgit2 but the aarch64 tests, gitSha.zig reads this
+    // to leave Git out of those.
+    const with_libgit2 = b.addOptions();
+    with_libgit2.addOption(bool, "libgit2", true);
+    const without_libgit2 = b.addOptions();
+    without_libgit2.addOption(bool, "libgit2", false);
+
     const exe = b.addExecutable(.{
         .name = "git-vain",
         .root_source_file = b.path("src/main.zig"),
@@ -23,6 +30,7 @@ pub fn build(b: *std.Build) void {
     });
 
     exe.linkSystemLibrary("libgit2");
+    exe.root_module.addOptions("build_options", with_libgit2);
 
     // This declares intent for the executable to be installed into the
     // standard location when the user invokes the "install" step (the default
@@ -61,6 +69,7 @@ pub fn build(b: *std.Build) void {
         .optimize = optimize,
     });
     exe_unit_tests.linkSystemLibrary("libgit2");
+    exe_unit_tests.root_module.addOptions("build_options", with_libgit2);
 
     const run_exe_unit_tests = b.addRunArtifact(exe_unit_tests);
 
@@ -70,6 +79,43 @@ pub fn build(b: *std.Build) void {
     const test_step = b.step("test", "Run unit tests");
     test_step.dependOn(&run_exe_unit_tests.step);
 
+    // The ARM64 kernels, cross compiled and run with qemu-aarch64 user mode so
+    // they can be checked on x86 Linux. neoverse_n1 has the crypto extension,
+    // so sha1ce.zig runs its asm, and sha1x4.zig its NEON path. The kernels
+    // and GitSha's Worker over them, there is no aarch64 libgit2 to link
+    // against.
+    const arm_tests = b.addTest(.{
+        .root_source_file = b.path("src/kernels.zig"),
+        .target = b.resolveTargetQuery(.{
+            .cpu_arch = .aarch64,
+            .os_tag = .linux,
+            .cpu_model = .{ .explicit = &std.Target.aarch64.cpu.neoverse_n1 },
+        }),
+        .optimize = optimize,
+    });
+    arm_tests.root_module.addOptions("build_options", without_libgit2);
+    const run_arm_tests = b.addSystemCommand(&.{ "qemu-aarch64", "-cpu", "max" });
+    run_arm_tests.addArtifactArg(arm_tests);
+
+    const arm_test_step = b.step("test-aarch64", "Run the ARM64 kernel tests under qemu-aarch64");
+    arm_test_step.dependOn(&run_arm_tests.step);
+
+    // The archived C implementation (archive/git-vain.c), kept buildable as a
+    // baseline for tools/bench. Uses CommonCrypto on macOS, archive/sha1.c elsewhere.
+    const baseline = b.addExecutable(.{
+        .name = "git-vain-c",
+        .target = target,
+        .optimize = .ReleaseFast,
+    });
+    baseline.addCSourceFiles(.{
+        .files = &.{ "archive/git-vain.c", "archive/sha1.c" },
+        .flags = &.{"-std=gnu11"},
+    });
+    baseline.linkLibC();
+
+    const baseline_step = b.step("baseline", "Build the archived C version for benchmarking");
+    baseline_step.dependOn(&b.addInstallArtifact(baseline, .{}).step);
+
     // zls https://kristoff.it/blog/improving-your-zls-experience/
     const exe_check = b.addExecutable(.{
         .name = "git-vain",
@@ -78,6 +124,7 @@ pub fn build(b: *std.Build) void {
         .optimize = optimize,
     });
     exe_check.linkSystemLibrary("libgit2");
+    exe_check.root_module.addOptions("build_options", with_libgit2);
 
     const check = b.step("check", "Check if foo compiles");
     check.dependOn(&exe_check.step);
@@ -0,0 +1,13 @@
+// The hash kernels on their own, without libgit2, so their tests can be cross
+// compiled and run under emulation (`zig build test-aarch64`). GitSha comes
+// along for its Worker tests, which run every kernel from a real midstate.
+pub const Kernel = @import("lib/kernel.zig").Kernel;
+pub const sha1ce = @import("lib/sha1ce.zig");
+pub const sha1x4 = @import("lib/sha1x4.zig");
+pub const sha256ni = @import("lib/sha256ni.zig");
+pub const sha256x8 = @import("lib/sha256x8.zig");
+pub const gitSha = @import("lib/gitSha.zig");
+
+comptime {
+    @import("std").testing.refAllDecls(@This());
+}
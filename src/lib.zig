@@ -1,7 +1,20 @@
-pub const GitSha = @import("lib/gitSha.zig");
+pub const GitSha = @import("lib/gitSha.zig").GitSha;
 pub const Target = @import("lib/target.zig");
+pub const Goal = @import("lib/goal.zig");
+pub const ObjectIndex = @import("lib/objectIndex.zig");
 pub const FoundFlag = @import("lib/foundFlag.zig");
 pub const Git = @import("lib/git.zig");
+pub const GitAlloc = @import("lib/gitAlloc.zig");
+pub const ObjectFormat = @import("lib/objectFormat.zig").ObjectFormat;
+pub const Kernel = @import("lib/kernel.zig").Kernel;
+pub const Bench = @import("lib/bench.zig");
+pub const Corpus = @import("lib/corpus.zig");
+pub const Search = @import("lib/search.zig").Search;
+pub const JobArena = @import("lib/search.zig").JobArena;
+pub const verify_every_default = @import("lib/search.zig").verify_every_default;
+pub const Range = @import("lib/range.zig").Range;
+pub const CommitGraph = @import("lib/commitGraph.zig");
+pub const Audit = @import("lib/audit.zig");
 
 pub const Cpu = switch (@import("builtin").os.tag) {
     .macos => @import("lib/cpu_macos.zig"),
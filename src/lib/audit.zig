@@ -0,0 +1,289 @@
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const Git = @import("git.zig");
+const Goal = @import("goal.zig");
+const CommitGraph = @import("commitGraph.zig");
+const parseHeader = @import("gitSha.zig").parseHeader;
+const commitParents = @import("range.zig").parents;
+
+// `git-vain audit <a>..<b> [pattern...] [--drift]`: which commits in the range
+// already match any of the patterns. The range is resolved on the
+// commit-graph, parents by position and ids read from the mapped file, so
+// nothing is inflated unless --drift asks for the matches' timestamps. A
+// range the graph doesn't cover (no graph, or a tip newer than it) is walked
+// through Git instead. Drift is how far a match's committer time sits from
+// its newest parent's, what a vanity search moves; below zero it was
+// committed before a parent.
+
+pub const Options = struct {
+    patterns: []const []const u8,
+    drift: bool = false,
+    threads: usize,
+};
+
+const Hit = struct {
+    commit: usize, // into the range's ids
+    pattern: usize,
+};
+
+// a line of the JSON list, the times only with --drift
+const Match = struct {
+    oid: [:0]const u8,
+    pattern: []const u8,
+    author_time: ?i64 = null,
+    committer_time: ?i64 = null,
+    parent_time: ?i64 = null, // the newest parent's committer time
+    drift: ?i64 = null, // committer - parent_time, none for a root
+};
+
+pub fn run(git: *Git, range: [:0]const u8, options: Options, allocator: Allocator) !void {
+    var arena_state = std.heap.ArenaAllocator.init(allocator);
+    defer arena_state.deinit();
+    const arena = arena_state.allocator();
+
+    const hash_len = git.format.hexLength() / 2;
+    const goals = try arena.alloc(Goal, options.patterns.len);
+    for (goals, options.patterns) |*goal, pattern| goal.* = try Goal.parse(pattern, hash_len * 2);
+
+    var graph = try CommitGraph.load(try git.objectsDir(arena), hash_len, allocator);
+    defer if (graph) |*g| g.deinit();
+
+    var ids: []const []const u8 = undefined;
+    var positions: ?[]const u32 = null;
+    if (graph) |*g| {
+        positions = try rangeOnGraph(git, g, range, arena);
+        if (positions == null) std.debug.print("the range is newer than the commit-graph, walking it\n", .{});
+    } else {
+        std.debug.print("no commit-graph, walking the range\n", .{});
+    }
+    if (positions) |p| {
+        const slices = try arena.alloc([]const u8, p.len);
+        for (slices, p) |*s, pos| s.* = graph.?.oid(pos);
+        ids = slices;
+    } else {
+        ids = try rangeWalked(git, range, hash_len, arena);
+    }
+
+    const hits = try matchAll(ids, goals, options.threads, arena);
+
+    const matches = try arena.alloc(Match, hits.len);
+    const per_pattern = try arena.alloc(usize, goals.len);
+    @memset(per_pattern, 0);
+    var behind_parent: usize = 0;
+    var widest: i64 = 0;
+    for (matches, hits) |*m, hit| {
+        per_pattern[hit.pattern] += 1;
+        const hex = try std.fmt.allocPrintZ(arena, "{}", .{std.fmt.fmtSliceHexLower(ids[hit.commit])});
+        m.* = .{ .oid = hex, .pattern = options.patterns[hit.pattern] };
+        if (!options.drift) continue;
+
+        if (positions) |p| {
+            try times(git, m, &graph.?, p[hit.commit], arena);
+        } else {
+            try times(git, m, null, 0, arena);
+        }
+        const d = m.drift orelse continue;
+        widest = @max(widest, @as(i64, @intCast(@abs(d))));
+        behind_parent += @intFromBool(d < 0);
+    }
+
+    std.debug.print("{d} commits, {d} match\n", .{ ids.len, hits.len });
+    for (options.patterns, per_pattern) |pattern, n| std.debug.print("  {s}: {d}\n", .{ pattern, n });
+    if (options.drift) {
+        std.debug.print("widest drift from a parent {d}s, {d} committed before one\n", .{ widest, behind_parent });
+    }
+
+    const out = std.io.getStdOut().writer();
+    try std.json.stringify(matches, .{ .whitespace = .indent_2, .emit_null_optional_fields = false }, out);
+    try out.writeByte('\n');
+}
+
+// Positions of "<a>..<b>" (or everything behind a lone <b>) on the graph.
+// null when a tip isn't in the graph.
+fn rangeOnGraph(git: *Git, graph: *const CommitGraph, range: [:0]const u8, arena: Allocator) !?[]const u32 {
+    const dots = std.mem.indexOf(u8, range, "..");
+    const from = if (dots) |d| range[0..d] else "";
+    const to = if (dots) |d| range[d + 2 ..] else range;
+
+    var from_pos: ?u32 = null;
+    if (from.len > 0) from_pos = try graphPosition(git, graph, from, arena) orelse return null;
+    const to_pos = try graphPosition(git, graph, if (to.len > 0) to else "HEAD", arena) orelse return null;
+    return try between(graph, from_pos, to_pos, arena);
+}
+
+// everything reachable from `to` that `from` can't reach
+fn between(graph: *const CommitGraph, from: ?u32, to: u32, arena: Allocator) ![]const u32 {
+    var excluded = try std.DynamicBitSetUnmanaged.initEmpty(arena, graph.count());
+    if (from) |tip| try walk(graph, tip, &excluded, null, arena);
+    var included = std.ArrayList(u32).init(arena);
+    try walk(graph, to, &excluded, &included, arena);
+    return included.items;
+}
+
+fn graphPosition(git: *Git, graph: *const CommitGraph, spec: []const u8, arena: Allocator) !?u32 {
+    const hex = try git.revParse(try arena.dupeZ(u8, spec), arena);
+    var id: [32]u8 = undefined;
+    const bytes = try std.fmt.hexToBytes(&id, hex);
+    return graph.find(bytes);
+}
+
+// marks everything reachable from `tip` in `seen`, collecting what wasn't
+// marked yet into `out`
+fn walk(graph: *const CommitGraph, tip: u32, seen: *std.DynamicBitSetUnmanaged, out: ?*std.ArrayList(u32), arena: Allocator) !void {
+    var stack = std.ArrayList(u32).init(arena);
+    defer stack.deinit();
+    try stack.append(tip);
+    while (stack.popOrNull()) |pos| {
+        if (seen.isSet(pos)) continue;
+        seen.set(pos);
+        if (out) |o| try o.append(pos);
+        var it = graph.parents(pos);
+        while (it.next()) |p| if (!seen.isSet(p)) try stack.append(p);
+    }
+}
+
+fn rangeWalked(git: *Git, range: [:0]const u8, hash_len: usize, arena: Allocator) ![]const []const u8 {
+    const hexes = try git.rangeCommits(range, arena);
+    const ids = try arena.alloc([]const u8, hexes.len);
+    for (ids, hexes) |*id, hex| id.* = try std.fmt.hexToBytes(try arena.alloc(u8, hash_len), hex);
+    return ids;
+}
+
+// Every thread takes a contiguous share of the ids, so concatenating their
+// hits in order keeps the range's order.
+fn matchAll(ids: []const []const u8, goals: []const Goal, threads: usize, arena: Allocator) ![]const Hit {
+    const shares = try arena.alloc(std.ArrayListUnmanaged(Hit), threads);
+    const handles = try arena.alloc(std.Thread, threads);
+    var safe = std.heap.ThreadSafeAllocator{ .child_allocator = arena };
+    const per = (ids.len + threads - 1) / threads;
+
+    for (shares, handles, 0..) |*share, *handle, t| {
+        share.* = .{};
+        const start = @min(ids.len, t * per);
+        const end = @min(ids.len, start + per);
+        handle.* = try std.Thread.spawn(.{}, matchShare, .{ ids, start, end, goals, share, safe.allocator() });
+    }
+    for (handles) |h| h.join();
+
+    var hits = std.ArrayList(Hit).init(arena);
+    for (shares) |share| try hits.appendSlice(share.items);
+    return hits.items;
+}
+
+fn matchShare(ids: []const []const u8, start: usize, end: usize, goals: []const Goal, out: *std.ArrayListUnmanaged(Hit), allocator: Allocator) !void {
+    for (ids[start..end], start..) |id, i| {
+        for (goals, 0..) |*goal, g| {
+            if (!goal.match(id)) continue;
+            try out.append(allocator, .{ .commit = i, .pattern = g });
+            break; // the first pattern it matches
+        }
+    }
+}
+
+// Only matches are inflated. The parents' committer times come from the
+// graph when the commit is in it.
+fn times(git: *Git, m: *Match, graph: ?*const CommitGraph, pos: u32, arena: Allocator) !void {
+    const raw = try git.commitRaw(m.oid, arena);
+    defer raw.deinit(arena);
+    const info = try parseHeader(raw.header);
+    m.author_time = info.author_time;
+    m.committer_time = info.committer_time;
+
+    if (graph) |g| {
+        var it = g.parents(pos);
+        while (it.next()) |p| m.parent_time = @max(m.parent_time orelse p_min, g.commitTime(p));
+    } else {
+        var it = commitParents(raw.header);
+        while (it.next()) |p| {
+            const parent = try git.commitRaw(try arena.dupeZ(u8, p.oid), arena);
+            defer parent.deinit(arena);
+            m.parent_time = @max(m.parent_time orelse p_min, (try parseHeader(parent.header)).committer_time);
+        }
+    }
+    if (m.parent_time) |t| m.drift = info.committer_time - t;
+}
+
+const p_min = std.math.minInt(i64);
+
+test "between" {
+    const Sha1 = std.crypto.hash.Sha1;
+    var arena_state = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena_state.deinit();
+    const arena = arena_state.allocator();
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    try tmp.dir.makePath("objects/info");
+    const dir = try tmp.dir.realpathAlloc(arena, "objects");
+
+    // root - a - b and root - c - d, merged by the octopus m (b, c, d)
+    const tree = [_]u8{0xee} ** 20;
+    const root = [_]u8{0x90} ** 20;
+    const a = [_]u8{0x10} ** 20;
+    const b = [_]u8{0x20} ** 20;
+    const c = [_]u8{0x30} ** 20;
+    const d = [_]u8{0x40} ** 20;
+    const m = [_]u8{0x05} ** 20;
+    var lock = try CommitGraph.Lock.take(dir);
+    defer lock.release();
+    const empty = CommitGraph{ .hash_len = 20, .allocator = arena, .split = true };
+    try empty.writeLayer(Sha1, &lock, dir, &.{
+        .{ .oid = &root, .tree = &tree, .parents = &.{}, .time = 100 },
+        .{ .oid = &a, .tree = &tree, .parents = &.{&root}, .time = 200 },
+        .{ .oid = &b, .tree = &tree, .parents = &.{&a}, .time = 300 },
+        .{ .oid = &c, .tree = &tree, .parents = &.{&root}, .time = 250 },
+        .{ .oid = &d, .tree = &tree, .parents = &.{&c}, .time = 260 },
+        .{ .oid = &m, .tree = &tree, .parents = &.{ &b, &c, &d }, .time = 400 },
+    }, arena);
+    var graph = (try CommitGraph.load(dir, 20, arena)).?;
+    defer graph.deinit();
+
+    const ids = struct {
+        fn of(g: *const CommitGraph, positions: []const u32, al: Allocator) ![]const u8 {
+            const out = try al.alloc(u8, positions.len);
+            for (out, positions) |*o, pos| o.* = g.oid(pos)[0];
+            std.mem.sort(u8, out, {}, std.sort.asc(u8));
+            return out;
+        }
+    }.of;
+
+    // everything behind m, the side branch only through the octopus' EDGE
+    try std.testing.expectEqualSlices(u8, &.{ 0x05, 0x10, 0x20, 0x30, 0x40, 0x90 }, try ids(&graph, try between(&graph, null, graph.find(&m).?, arena), arena));
+    // b..m leaves b's history out
+    try std.testing.expectEqualSlices(u8, &.{ 0x05, 0x30, 0x40 }, try ids(&graph, try between(&graph, graph.find(&b).?, graph.find(&m).?, arena), arena));
+    // d..m
+    try std.testing.expectEqualSlices(u8, &.{ 0x05, 0x10, 0x20 }, try ids(&graph, try between(&graph, graph.find(&d).?, graph.find(&m).?, arena), arena));
+    // m..b is empty
+    try std.testing.expectEqual(0, (try between(&graph, graph.find(&m).?, graph.find(&b).?, arena)).len);
+}
+
+test "matchAll keeps the range's order" {
+    var arena_state = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena_state.deinit();
+    const arena = arena_state.allocator();
+
+    // every third id starts with ab, every fifth with cd unless it's ab already
+    var bytes: [30][20]u8 = undefined;
+    var ids: [30][]const u8 = undefined;
+    for (&bytes, &ids, 0..) |*b, *id, i| {
+        b.* = [_]u8{0x11} ** 20;
+        if (i % 5 == 0) b[0] = 0xcd;
+        if (i % 3 == 0) b[0] = 0xab;
+        id.* = b;
+    }
+    const goals = [_]Goal{ try Goal.parse("ab", 40), try Goal.parse("cd", 40) };
+
+    for ([_]usize{ 1, 4, 7, 64 }) |threads| {
+        const hits = try matchAll(&ids, &goals, threads, arena);
+        try std.testing.expectEqual(10 + 4, hits.len); // 0, 15 are ab
+        var last: ?usize = null;
+        for (hits) |hit| {
+            if (last) |l| try std.testing.expect(hit.commit > l);
+            last = hit.commit;
+            try std.testing.expectEqual(@as(usize, if (hit.commit % 3 == 0) 0 else 1), hit.pattern);
+        }
+    }
+}
+
+comptime {
+    std.testing.refAllDecls(@This());
+}
@@ -0,0 +1,135 @@
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const ObjectFormat = @import("objectFormat.zig").ObjectFormat;
+const Kernel = @import("kernel.zig").Kernel;
+const GitSha = @import("gitSha.zig").GitSha;
+const corpus = @import("corpus.zig");
+const Rapl = @import("rapl.zig");
+
+// `git-vain bench`: every corpus layout through every kernel the build
+// supports, single threaded and on all perf cores. Nothing is matched or
+// written, it only measures the hashing. Where the powercap counters are
+// readable, package energy per million hashes and average power go next to it.
+
+pub const Options = struct {
+    hashes: u64 = 8_000_000,
+    threads: u8,
+};
+
+const Result = struct {
+    hashes: u64,
+    ns: u64,
+    joules: ?f64 = null, // every package, idle cores included
+
+    fn mhs(self: Result) f64 {
+        return @as(f64, @floatFromInt(self.hashes)) * 1000 / @as(f64, @floatFromInt(self.ns));
+    }
+
+    fn joulesPerMh(self: Result) f64 {
+        return self.joules.? * 1_000_000 / @as(f64, @floatFromInt(self.hashes));
+    }
+
+    fn watts(self: Result) f64 {
+        return self.joules.? * std.time.ns_per_s / @as(f64, @floatFromInt(self.ns));
+    }
+};
+
+pub fn run(allocator: Allocator, options: Options) !void {
+    const out = std.io.getStdOut().writer();
+    var meter = Rapl.open();
+    defer if (meter) |*m| m.close();
+
+    try out.print("{s:<13} {s:<7} {s:<10} {s:>7} {s:>6} {s:>8}", .{ "layout", "format", "kernel", "threads", "blocks", "Mh/s" });
+    if (meter != null) try out.print(" {s:>7} {s:>6}", .{ "J/Mh", "W" });
+    try out.writeByte('\n');
+
+    const thread_counts = [_]u8{ 1, options.threads };
+    inline for (.{ ObjectFormat.sha1, ObjectFormat.sha256 }) |format| {
+        const Sha = GitSha(format.Hash());
+        for (corpus.shapes) |shape| {
+            const layout = try corpus.generate(allocator, shape, format);
+            defer layout.deinit(allocator);
+
+            var sha = try Sha.initRaw(layout.header, layout.message, allocator);
+            defer sha.deinit(allocator);
+
+            inline for (std.meta.fields(Kernel)) |f| {
+                const k: Kernel = @enumFromInt(f.value);
+                if (k.supports(format)) {
+                    for (thread_counts, 0..) |threads, i| {
+                        if (i > 0 and threads == thread_counts[0]) continue;
+                        const result = try measure(Sha, &sha, k, threads, options.hashes, if (meter) |*m| m else null, allocator);
+                        try out.print("{s:<13} {s:<7} {s:<10} {d:>7} {d:>6} {d:>8.1}", .{
+                            layout.name,
+                            @tagName(format),
+                            @tagName(k),
+                            threads,
+                            sha.tail.len / 64,
+                            result.mhs(),
+                        });
+                        if (result.joules != null) try out.print(" {d:>7.2} {d:>6.1}", .{ result.joulesPerMh(), result.watts() });
+                        try out.writeByte('\n');
+                    }
+                }
+            }
+        }
+    }
+}
+
+fn measure(comptime Sha: type, sha: *const Sha, k: Kernel, threads: u8, hashes: u64, meter: ?*const Rapl, allocator: Allocator) !Result {
+    const Grind = struct {
+        fn grind(s: *const Sha, kern: Kernel, thread: i32, count: u64, alloc: Allocator) !void {
+            var worker = try Sha.Worker.init(s, kern, alloc);
+            defer worker.deinit(alloc);
+
+            const lanes = kern.lanes();
+            var ns: [Kernel.max_lanes]i32 = undefined;
+            var results: [Kernel.max_lanes]Sha.Digest = undefined;
+            // separate spiral ranges per thread, the offsets stay small either way
+            var n: i32 = thread * 1_000_000 + 1;
+            var done: u64 = 0;
+
+            while (done < count) : (done += lanes) {
+                for (ns[0..lanes]) |*slot| {
+                    slot.* = n;
+                    n += 1;
+                }
+                try worker.run(ns[0..lanes], results[0..lanes]);
+                std.mem.doNotOptimizeAway(&results);
+            }
+        }
+    };
+
+    const per_thread = hashes / threads / k.lanes() * k.lanes();
+    var handles: [std.math.maxInt(u8)]std.Thread = undefined;
+
+    var energy_start: Rapl.Sample = undefined;
+    if (meter) |m| energy_start = m.read();
+    var timer = try std.time.Timer.start();
+    for (0..threads) |t| {
+        handles[t] = try std.Thread.spawn(.{}, Grind.grind, .{ sha, k, @as(i32, @intCast(t)), per_thread, allocator });
+    }
+    for (handles[0..threads]) |h| h.join();
+
+    const ns = timer.read();
+
+    const joules = if (meter) |m| m.joules(energy_start, m.read()) else null;
+    return .{ .hashes = per_thread * threads, .ns = ns, .joules = joules };
+}
+
+test "measure" {
+    const allocator = std.testing.allocator;
+    const Sha = GitSha(std.crypto.hash.Sha1);
+    const layout = try corpus.generate(allocator, corpus.shapes[1], .sha1);
+    defer layout.deinit(allocator);
+
+    var sha = try Sha.initRaw(layout.header, layout.message, allocator);
+    defer sha.deinit(allocator);
+
+    const result = try measure(Sha, &sha, .scalar, 2, 1000, null, allocator);
+    try std.testing.expectEqual(1000, result.hashes);
+}
+
+comptime {
+    std.testing.refAllDecls(@This());
+}
@@ -0,0 +1,548 @@
+const Self = @This();
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+// The commit-graph: `<objects>/info/commit-graph`, or the split chain under
+// `info/commit-graphs/` that incremental writes leave (base layer first,
+// positions in a layer count on from the layers below it). Every layer is
+// mapped as is and read in place: OIDL holds the sorted ids, CDAT a record
+// per commit with its tree, two parent positions and generation+time, EDGE
+// the rest of an octopus merge's parents.
+
+pub const no_parent: u32 = 0x70000000;
+pub const extra_edges: u32 = 0x80000000;
+
+pub const Layer = struct {
+    map: []align(std.mem.page_size) const u8,
+    base: u32, // commits in the layers below
+    count: u32 = 0,
+    fanout: []const u8 = &.{},
+    oids: []const u8 = &.{},
+    data: []const u8 = &.{},
+    edges: []const u8 = &.{},
+};
+
+hash_len: usize,
+layers: std.ArrayListUnmanaged(Layer) = .{},
+split: bool = false, // read from commit-graphs/ rather than the single file
+allocator: Allocator,
+
+/// null when the repository has no commit-graph yet.
+pub fn load(objects_dir: []const u8, hash_len: usize, allocator: Allocator) !?Self {
+    var self = Self{ .hash_len = hash_len, .allocator = allocator };
+    errdefer self.deinit();
+
+    var objects = try std.fs.cwd().openDir(objects_dir, .{});
+    defer objects.close();
+    var info = objects.openDir("info", .{}) catch |err| switch (err) {
+        error.FileNotFound => return null,
+        else => return err,
+    };
+    defer info.close();
+
+    if (info.openFile("commit-graph", .{})) |file| {
+        defer file.close();
+        try self.mapLayer(file);
+    } else |err| switch (err) {
+        error.FileNotFound => try self.loadChain(info),
+        else => return err,
+    }
+
+    if (self.layers.items.len == 0) {
+        self.deinit();
+        return null;
+    }
+    return self;
+}
+
+pub fn deinit(self: *Self) void {
+    for (self.layers.items) |layer| std.posix.munmap(layer.map);
+    self.layers.deinit(self.allocator);
+}
+
+fn loadChain(self: *Self, info: std.fs.Dir) !void {
+    var dir = info.openDir("commit-graphs", .{}) catch |err| switch (err) {
+        error.FileNotFound => return,
+        else => return err,
+    };
+    defer dir.close();
+    const chain = dir.readFileAlloc(self.allocator, "commit-graph-chain", 1 << 20) catch |err| switch (err) {
+        error.FileNotFound => return,
+        else => return err,
+    };
+    defer self.allocator.free(chain);
+
+    self.split = true;
+    var lines = std.mem.tokenizeScalar(u8, chain, '\n');
+    while (lines.next()) |hash| {
+        var name: [80]u8 = undefined;
+        const file = try dir.openFile(try std.fmt.bufPrint(&name, "graph-{s}.graph", .{hash}), .{});
+        defer file.close();
+        try self.mapLayer(file);
+    }
+}
+
+fn mapLayer(self: *Self, file: std.fs.File) !void {
+    const size: usize = @intCast((try file.stat()).size);
+    if (size < 8 + 12) return error.BadCommitGraph;
+    const map = try std.posix.mmap(null, size, std.posix.PROT.READ, .{ .TYPE = .PRIVATE }, file.handle, 0);
+    errdefer std.posix.munmap(map);
+    if (!std.mem.eql(u8, map[0..4], "CGPH") or map[4] != 1) return error.BadCommitGraph;
+
+    // table of contents: an id and offset per chunk, the next entry's offset ends it
+    const chunks: usize = map[6];
+    if (size < 8 + (chunks + 1) * 12) return error.BadCommitGraph;
+    var layer = Layer{ .map = map, .base = self.count() };
+    for (0..chunks) |i| {
+        const entry = map[8 + i * 12 ..];
+        const start = std.mem.readInt(u64, entry[4..12], .big);
+        const end = std.mem.readInt(u64, entry[16..24], .big);
+        if (start > end or end > size) return error.BadCommitGraph;
+        const chunk = map[@intCast(start)..@intCast(end)];
+
+        const id = entry[0..4];
+        if (std.mem.eql(u8, id, "OIDF")) layer.fanout = chunk;
+        if (std.mem.eql(u8, id, "OIDL")) layer.oids = chunk;
+        if (std.mem.eql(u8, id, "CDAT")) layer.data = chunk;
+        if (std.mem.eql(u8, id, "EDGE")) layer.edges = chunk;
+    }
+
+    if (layer.fanout.len != 256 * 4) return error.BadCommitGraph;
+    layer.count = std.mem.readInt(u32, layer.fanout[255 * 4 ..][0..4], .big);
+    if (layer.oids.len < layer.count * self.hash_len or layer.data.len < layer.count * self.recordLen()) {
+        return error.BadCommitGraph;
+    }
+    try self.layers.append(self.allocator, layer);
+}
+
+fn recordLen(self: *const Self) usize {
+    return self.hash_len + 16;
+}
+
+/// Commits in every layer.
+pub fn count(self: *const Self) u32 {
+    const top = self.layers.getLastOrNull() orelse return 0;
+    return top.base + top.count;
+}
+
+fn layerOf(self: *const Self, pos: u32) *const Layer {
+    var i = self.layers.items.len;
+    while (i > 0) {
+        i -= 1;
+        if (pos >= self.layers.items[i].base) return &self.layers.items[i];
+    }
+    unreachable;
+}
+
+pub fn oid(self: *const Self, pos: u32) []const u8 {
+    const layer = self.layerOf(pos);
+    return layer.oids[(pos - layer.base) * self.hash_len ..][0..self.hash_len];
+}
+
+fn record(self: *const Self, pos: u32) []const u8 {
+    const layer = self.layerOf(pos);
+    return layer.data[(pos - layer.base) * self.recordLen() ..][0..self.recordLen()];
+}
+
+/// Position of `id`, a fanout bucket and binary search per layer.
+pub fn find(self: *const Self, id: []const u8) ?u32 {
+    for (self.layers.items) |*layer| {
+        var lo: u32 = if (id[0] == 0) 0 else std.mem.readInt(u32, layer.fanout[(@as(usize, id[0]) - 1) * 4 ..][0..4], .big);
+        var hi = std.mem.readInt(u32, layer.fanout[@as(usize, id[0]) * 4 ..][0..4], .big);
+        while (lo < hi) {
+            const mid = lo + (hi - lo) / 2;
+            switch (std.mem.order(u8, layer.oids[mid * self.hash_len ..][0..self.hash_len], id)) {
+                .lt => lo = mid + 1,
+                .gt => hi = mid,
+                .eq => return layer.base + mid,
+            }
+        }
+    }
+    return null;
+}
+
+/// Committer time, seconds.
+pub fn commitTime(self: *const Self, pos: u32) i64 {
+    const r = self.record(pos)[self.hash_len + 8 ..];
+    const high: u64 = std.mem.readInt(u32, r[0..4], .big) & 3;
+    return @intCast(high << 32 | std.mem.readInt(u32, r[4..8], .big));
+}
+
+/// Topological level, one more than the highest parent's, 0 when not computed.
+pub fn generation(self: *const Self, pos: u32) u32 {
+    return std.mem.readInt(u32, self.record(pos)[self.hash_len + 8 ..][0..4], .big) >> 2;
+}
+
+pub fn parents(self: *const Self, pos: u32) Parents {
+    const r = self.record(pos)[self.hash_len..];
+    return .{
+        .layer = self.layerOf(pos),
+        .pending = .{ std.mem.readInt(u32, r[0..4], .big), std.mem.readInt(u32, r[4..8], .big) },
+    };
+}
+
+pub const Parents = struct {
+    layer: *const Layer,
+    pending: [2]u32,
+    i: usize = 0,
+    // an octopus merge's second value points into EDGE, whose last entry for
+    // the commit has the high bit set
+    edge: ?usize = null,
+
+    pub fn next(self: *Parents) ?u32 {
+        if (self.i < 2) {
+            const v = self.pending[self.i];
+            self.i += 1;
+            if (v == no_parent) {
+                self.i = 2;
+                return null;
+            }
+            if (self.i == 1 or v & extra_edges == 0) return v;
+            self.edge = v & ~extra_edges;
+        }
+
+        const e = self.edge orelse return null;
+        if ((e + 1) * 4 > self.layer.edges.len) return null;
+        const v = std.mem.readInt(u32, self.layer.edges[e * 4 ..][0..4], .big);
+        self.edge = if (v & extra_edges != 0) null else e + 1;
+        return v & ~extra_edges;
+    }
+};
+
+/// A commit for a new layer. Its parents are already in the graph or come
+/// earlier in the same layer.
+pub const NewCommit = struct {
+    oid: []const u8,
+    tree: []const u8,
+    parents: []const []const u8,
+    time: i64, // committer
+};
+
+const max_generation = 0x3fffffff;
+
+/// Adds `commits` (parents before children) as a new layer on top, turning a
+/// single commit-graph file into the chain's base first like `git
+/// commit-graph write --split` does. `lock` has to be held since before the
+/// graph was loaded, which is stale afterwards.
+pub fn writeLayer(self: *const Self, comptime Hash: type, lock: *Lock, objects_dir: []const u8, commits: []const NewCommit, allocator: Allocator) !void {
+    std.debug.assert(Hash.digest_length == self.hash_len);
+    const base = self.count();
+    const n = commits.len;
+
+    // positions go by oid, `order[k]` is the commit at base + k
+    const order = try allocator.alloc(u32, n);
+    defer allocator.free(order);
+    for (order, 0..) |*o, i| o.* = @intCast(i);
+    std.mem.sort(u32, order, commits, byOid);
+
+    // parent positions and generations, in the order given so parents come first
+    const gens = try allocator.alloc(u32, n);
+    defer allocator.free(gens);
+    const first_parent = try allocator.alloc(usize, n + 1);
+    defer allocator.free(first_parent);
+    var parent_pos = std.ArrayList(u32).init(allocator);
+    defer parent_pos.deinit();
+    for (commits, 0..) |c, i| {
+        first_parent[i] = parent_pos.items.len;
+        var gen: u32 = 0;
+        for (c.parents) |p| {
+            const at = if (findNew(commits, order, p)) |k| base + k else self.find(p) orelse return error.ParentNotInGraph;
+            try parent_pos.append(at);
+            gen = @max(gen, if (at >= base) gens[order[at - base]] else self.generation(at));
+        }
+        gens[i] = @min(gen + 1, max_generation);
+    }
+    first_parent[n] = parent_pos.items.len;
+
+    var data = std.ArrayList(u8).init(allocator);
+    defer data.deinit();
+    var edges = std.ArrayList(u8).init(allocator);
+    defer edges.deinit();
+    for (order) |c| {
+        const ps = parent_pos.items[first_parent[c]..first_parent[c + 1]];
+        try data.appendSlice(commits[c].tree);
+        try data.writer().writeInt(u32, if (ps.len > 0) ps[0] else no_parent, .big);
+        const second = switch (ps.len) {
+            0, 1 => no_parent,
+            2 => ps[1],
+            else => blk: {
+                const at: u32 = @intCast(edges.items.len / 4);
+                for (ps[1..], 2..) |p, j| try edges.writer().writeInt(u32, if (j == ps.len) p | extra_edges else p, .big);
+                break :blk at | extra_edges;
+            },
+        };
+        try data.writer().writeInt(u32, second, .big);
+        const time: u64 = @intCast(@max(0, commits[c].time));
+        try data.writer().writeInt(u32, gens[c] << 2 | @as(u32, @intCast(time >> 32 & 3)), .big);
+        try data.writer().writeInt(u32, @truncate(time), .big);
+    }
+
+    var bases = std.ArrayList(u8).init(allocator);
+    defer bases.deinit();
+    for (self.layers.items) |layer| try bases.appendSlice(checksum(layer, self.hash_len));
+
+    var oids = std.ArrayList(u8).init(allocator);
+    defer oids.deinit();
+    var fanout = std.ArrayList(u8).init(allocator);
+    defer fanout.deinit();
+    var k: usize = 0;
+    for (0..256) |b| {
+        while (k < n and commits[order[k]].oid[0] <= b) : (k += 1) try oids.appendSlice(commits[order[k]].oid);
+        try fanout.writer().writeInt(u32, @intCast(k), .big);
+    }
+
+    const Chunk = struct { id: *const [4]u8, bytes: []const u8 };
+    var chunks = std.BoundedArray(Chunk, 5){};
+    chunks.appendAssumeCapacity(.{ .id = "OIDF", .bytes = fanout.items });
+    chunks.appendAssumeCapacity(.{ .id = "OIDL", .bytes = oids.items });
+    chunks.appendAssumeCapacity(.{ .id = "CDAT", .bytes = data.items });
+    if (edges.items.len > 0) chunks.appendAssumeCapacity(.{ .id = "EDGE", .bytes = edges.items });
+    if (bases.items.len > 0) chunks.appendAssumeCapacity(.{ .id = "BASE", .bytes = bases.items });
+
+    var out = std.ArrayList(u8).init(allocator);
+    defer out.deinit();
+    const w = out.writer();
+    try w.writeAll("CGPH");
+    try w.writeByte(1);
+    try w.writeByte(if (Hash.digest_length == 20) 1 else 2);
+    try w.writeByte(@intCast(chunks.len));
+    try w.writeByte(@intCast(self.layers.items.len));
+    var offset: u64 = 8 + (chunks.len + 1) * 12;
+    for (chunks.slice()) |chunk| {
+        try w.writeAll(chunk.id);
+        try w.writeInt(u64, offset, .big);
+        offset += chunk.bytes.len;
+    }
+    try w.writeInt(u32, 0, .big);
+    try w.writeInt(u64, offset, .big);
+    for (chunks.slice()) |chunk| try w.writeAll(chunk.bytes);
+    var sum: [Hash.digest_length]u8 = undefined;
+    Hash.hash(out.items, &sum, .{});
+    try w.writeAll(&sum);
+
+    try self.publish(lock, objects_dir, out.items, &sum, allocator);
+}
+
+// Layers are named after their checksum and listed base first in the chain
+// file, which is replaced last so readers never see a layer without its base.
+// A single file turned into the chain's base goes back if anything after that
+// fails.
+fn publish(self: *const Self, lock: *Lock, objects_dir: []const u8, file: []const u8, sum: []const u8, allocator: Allocator) !void {
+    var objects = try std.fs.cwd().openDir(objects_dir, .{});
+    defer objects.close();
+
+    var chain = std.ArrayList(u8).init(allocator);
+    defer chain.deinit();
+    for (self.layers.items) |layer| try chain.writer().print("{}\n", .{std.fmt.fmtSliceHexLower(checksum(layer, self.hash_len))});
+    try chain.writer().print("{}\n", .{std.fmt.fmtSliceHexLower(sum)});
+
+    var name: [80]u8 = undefined;
+    const layer_name = try std.fmt.bufPrint(&name, "graph-{}.graph", .{std.fmt.fmtSliceHexLower(sum)});
+    try lock.dir.writeFile(.{ .sub_path = layer_name, .data = file });
+    errdefer lock.dir.deleteFile(layer_name) catch {};
+
+    var base_name: [100]u8 = undefined;
+    const moved: ?[]const u8 = if (!self.split and self.layers.items.len == 1) blk: {
+        const old = std.fmt.fmtSliceHexLower(checksum(self.layers.items[0], self.hash_len));
+        const to = try std.fmt.bufPrint(&base_name, "info/commit-graphs/graph-{}.graph", .{old});
+        try objects.rename("info/commit-graph", to);
+        break :blk to;
+    } else null;
+    errdefer if (moved) |to| objects.rename(to, "info/commit-graph") catch {};
+
+    try lock.commit(chain.items);
+}
+
+/// `info/commit-graphs/commit-graph-chain.lock`, created exclusively like
+/// git's lockfile so a concurrent `git commit-graph write` or gc is never
+/// clobbered. Take it before `load` so the graph can't change until
+/// writeLayer replaces the chain with it.
+pub const Lock = struct {
+    dir: std.fs.Dir, // info/commit-graphs
+    file: std.fs.File,
+    committed: bool = false,
+
+    pub fn take(objects_dir: []const u8) !Lock {
+        var objects = try std.fs.cwd().openDir(objects_dir, .{});
+        defer objects.close();
+        try objects.makePath("info/commit-graphs");
+        var dir = try objects.openDir("info/commit-graphs", .{});
+        errdefer dir.close();
+
+        const file = dir.createFile("commit-graph-chain.lock", .{ .exclusive = true }) catch |err| switch (err) {
+            error.PathAlreadyExists => {
+                std.debug.print("{s}/info/commit-graphs/commit-graph-chain.lock exists, something else is writing the commit-graph\n", .{objects_dir});
+                return error.CommitGraphLocked;
+            },
+            else => return err,
+        };
+        return .{ .dir = dir, .file = file };
+    }
+
+    /// Drops the lock unless writeLayer made it the chain.
+    pub fn release(self: *Lock) void {
+        self.file.close();
+        if (!self.committed) self.dir.deleteFile("commit-graph-chain.lock") catch {};
+        self.dir.close();
+    }
+
+    fn commit(self: *Lock, chain: []const u8) !void {
+        try self.file.writeAll(chain);
+        try self.dir.rename("commit-graph-chain.lock", "commit-graph-chain");
+        self.committed = true;
+    }
+};
+
+fn checksum(layer: Layer, hash_len: usize) []const u8 {
+    return layer.map[layer.map.len - hash_len ..];
+}
+
+fn byOid(commits: []const NewCommit, a: u32, b: u32) bool {
+    return std.mem.order(u8, commits[a].oid, commits[b].oid) == .lt;
+}
+
+fn findNew(commits: []const NewCommit, order: []const u32, id: []const u8) ?u32 {
+    var lo: usize = 0;
+    var hi = order.len;
+    while (lo < hi) {
+        const mid = lo + (hi - lo) / 2;
+        switch (std.mem.order(u8, commits[order[mid]].oid, id)) {
+            .lt => lo = mid + 1,
+            .gt => hi = mid,
+            .eq => return @intCast(mid),
+        }
+    }
+    return null;
+}
+
+test "writeLayer" {
+    const Sha1 = std.crypto.hash.Sha1;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    try tmp.dir.makePath("objects/info");
+    const dir = try tmp.dir.realpathAlloc(std.testing.allocator, "objects");
+    defer std.testing.allocator.free(dir);
+
+    const tree = [_]u8{0xee} ** 20;
+    const root = [_]u8{0x90} ** 20;
+    const a = [_]u8{0x10} ** 20;
+    const b = [_]u8{0x20} ** 20;
+    const merge = [_]u8{0x05} ** 20;
+
+    // a base layer on an empty graph, then a layer with a three-way merge on it
+    {
+        var lock = try Lock.take(dir);
+        defer lock.release();
+        const empty = Self{ .hash_len = 20, .allocator = std.testing.allocator, .split = true };
+        try empty.writeLayer(Sha1, &lock, dir, &.{.{ .oid = &root, .tree = &tree, .parents = &.{}, .time = 100 }}, std.testing.allocator);
+    }
+    {
+        var lock = try Lock.take(dir);
+        defer lock.release();
+        var one = (try Self.load(dir, 20, std.testing.allocator)).?;
+        defer one.deinit();
+        try one.writeLayer(Sha1, &lock, dir, &.{
+            .{ .oid = &b, .tree = &tree, .parents = &.{&root}, .time = 200 },
+            .{ .oid = &a, .tree = &tree, .parents = &.{&b}, .time = 300 },
+            .{ .oid = &merge, .tree = &tree, .parents = &.{ &a, &b, &root }, .time = 1 << 33 },
+        }, std.testing.allocator);
+    }
+    // the lock became the chain both times
+    try std.testing.expectError(error.FileNotFound, tmp.dir.access("objects/info/commit-graphs/commit-graph-chain.lock", .{}));
+
+    var two = (try Self.load(dir, 20, std.testing.allocator)).?;
+    defer two.deinit();
+    try std.testing.expectEqual(2, two.layers.items.len);
+    try std.testing.expectEqual(4, two.count());
+
+    const m = two.find(&merge).?;
+    try std.testing.expectEqual(1, m); // sorts first in its layer
+    try std.testing.expectEqual(4, two.generation(m));
+    try std.testing.expectEqual(1 << 33, two.commitTime(m));
+    var it = two.parents(m);
+    try std.testing.expectEqual(two.find(&a), it.next());
+    try std.testing.expectEqual(two.find(&b), it.next());
+    try std.testing.expectEqual(0, it.next());
+    try std.testing.expectEqual(null, it.next());
+
+    try std.testing.expectEqual(1, two.generation(two.find(&root).?));
+    try std.testing.expectEqualSlices(u8, &a, two.oid(two.find(&a).?));
+}
+
+test "a held lock keeps others out" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    try tmp.dir.makePath("objects/info/commit-graphs");
+    try tmp.dir.writeFile(.{ .sub_path = "objects/info/commit-graphs/commit-graph-chain.lock", .data = "" });
+    const dir = try tmp.dir.realpathAlloc(std.testing.allocator, "objects");
+    defer std.testing.allocator.free(dir);
+
+    try std.testing.expectError(error.CommitGraphLocked, Lock.take(dir));
+    try tmp.dir.access("objects/info/commit-graphs/commit-graph-chain.lock", .{});
+    try std.testing.expectError(error.FileNotFound, tmp.dir.access("objects/info/commit-graphs/commit-graph-chain", .{}));
+}
+
+test "writeLayer puts a single file back when the chain can't be written" {
+    const Sha1 = std.crypto.hash.Sha1;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    try tmp.dir.makePath("objects/info");
+    const dir = try tmp.dir.realpathAlloc(std.testing.allocator, "objects");
+    defer std.testing.allocator.free(dir);
+
+    const tree = [_]u8{0xee} ** 20;
+    const root = [_]u8{0x90} ** 20;
+    const a = [_]u8{0x10} ** 20;
+
+    // a one layer chain turned into the single file a plain `git commit-graph write` leaves
+    {
+        var lock = try Lock.take(dir);
+        defer lock.release();
+        const empty = Self{ .hash_len = 20, .allocator = std.testing.allocator, .split = true };
+        try empty.writeLayer(Sha1, &lock, dir, &.{.{ .oid = &root, .tree = &tree, .parents = &.{}, .time = 100 }}, std.testing.allocator);
+    }
+    var graphs = try tmp.dir.openDir("objects/info/commit-graphs", .{ .iterate = true });
+    defer graphs.close();
+    var name: [160]u8 = undefined;
+    const chain = try graphs.readFile("commit-graph-chain", &name);
+    try graphs.rename(try std.fmt.bufPrint(name[chain.len..], "graph-{s}.graph", .{chain[0 .. chain.len - 1]}), "../commit-graph");
+    try graphs.deleteFile("commit-graph-chain");
+    // a directory in the chain file's place makes the last rename fail
+    try graphs.makePath("commit-graph-chain/in-the-way");
+
+    var lock = try Lock.take(dir);
+    defer lock.release();
+    var single = (try Self.load(dir, 20, std.testing.allocator)).?;
+    defer single.deinit();
+    try std.testing.expect(!single.split);
+    if (single.writeLayer(Sha1, &lock, dir, &.{.{ .oid = &a, .tree = &tree, .parents = &.{&root}, .time = 200 }}, std.testing.allocator)) |_| {
+        return error.TestUnexpectedResult;
+    } else |_| {}
+
+    try tmp.dir.access("objects/info/commit-graph", .{});
+    var it = graphs.iterate();
+    while (try it.next()) |entry| try std.testing.expect(!std.mem.endsWith(u8, entry.name, ".graph"));
+}
+
+test "parents" {
+    var map: [16]u8 align(std.mem.page_size) = [_]u8{0} ** 16;
+    const edges = [_]u8{ 0, 0, 0, 5, 0x80, 0, 0, 6 };
+    const layer = Layer{ .map = &map, .base = 0, .edges = &edges };
+
+    var it = Parents{ .layer = &layer, .pending = .{ 3, no_parent } };
+    try std.testing.expectEqual(3, it.next());
+    try std.testing.expectEqual(null, it.next());
+
+    it = .{ .layer = &layer, .pending = .{ no_parent, no_parent } };
+    try std.testing.expectEqual(null, it.next());
+
+    it = .{ .layer = &layer, .pending = .{ 1, extra_edges | 0 } };
+    try std.testing.expectEqual(1, it.next());
+    try std.testing.expectEqual(5, it.next());
+    try std.testing.expectEqual(6, it.next());
+    try std.testing.expectEqual(null, it.next());
+}
+
+comptime {
+    std.testing.refAllDecls(Self);
+}
@@ -0,0 +1,186 @@
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const ObjectFormat = @import("objectFormat.zig").ObjectFormat;
+const GitSha = @import("gitSha.zig").GitSha;
+const Kernel = @import("kernel.zig").Kernel;
+
+// Synthetic commit objects in the shapes real histories have. Throughput
+// depends on how many blocks sit behind the timestamps and where they fall
+// relative to the 64-byte block boundaries, so bench runs all of them.
+
+pub const Shape = struct {
+    name: []const u8,
+    parents: u8 = 1,
+    encoding: bool = false,
+    mergetag: bool = false,
+    gpgsig: bool = false,
+    message_len: usize = 40,
+    // pad the author name until the author timestamp crosses a block boundary
+    straddle: bool = false,
+};
+
+pub const shapes = [_]Shape{
+    .{ .name = "root", .parents = 0 },
+    .{ .name = "one-parent" },
+    .{ .name = "merge", .parents = 2 },
+    .{ .name = "octopus", .parents = 8 },
+    .{ .name = "encoding", .encoding = true },
+    .{ .name = "mergetag", .parents = 2, .mergetag = true },
+    .{ .name = "gpgsig", .gpgsig = true },
+    .{ .name = "long-message", .message_len = 4096 },
+    .{ .name = "straddle", .straddle = true },
+};
+
+pub const Layout = struct {
+    name: []const u8,
+    header: []const u8,
+    message: []const u8,
+    // where the generator put the timestamps, for checking parseHeader
+    author_time_start: usize,
+    committer_time_start: usize,
+
+    pub fn deinit(self: Layout, allocator: Allocator) void {
+        allocator.free(self.header);
+        allocator.free(self.message);
+    }
+};
+
+const author_time = "1721827347 +0200";
+const committer_time = "1721827399 +0200";
+
+pub fn generate(allocator: Allocator, shape: Shape, format: ObjectFormat) !Layout {
+    var pad: usize = 0;
+    while (true) : (pad += 1) {
+        const layout = try build(allocator, shape, format, pad);
+        if (!shape.straddle or straddles(layout)) return layout;
+        layout.deinit(allocator);
+    }
+}
+
+pub fn generateNamed(allocator: Allocator, name: []const u8, format: ObjectFormat) !Layout {
+    for (shapes) |shape| {
+        if (std.mem.eql(u8, shape.name, name)) return generate(allocator, shape, format);
+    }
+    return error.UnknownLayout;
+}
+
+// true when the author timestamp is split across two blocks of the object
+fn straddles(layout: Layout) bool {
+    var buf: [32]u8 = undefined;
+    const prefix = std.fmt.bufPrint(&buf, "commit {d}\x00", .{layout.header.len + 1 + layout.message.len}) catch unreachable;
+    const at = (prefix.len + layout.author_time_start) % 64;
+    return at > 64 - 10;
+}
+
+fn build(allocator: Allocator, shape: Shape, format: ObjectFormat, pad: usize) !Layout {
+    var oid_buf: [ObjectFormat.max_digest_length * 2]u8 = undefined;
+    for (&oid_buf, 0..) |*c, i| c.* = "0123456789abcdef"[(i * 7) % 16];
+    const oid = oid_buf[0..format.hexLength()];
+
+    var header = std.ArrayList(u8).init(allocator);
+    errdefer header.deinit();
+    const w = header.writer();
+
+    try w.print("tree {s}\n", .{oid});
+    for (0..shape.parents) |_| try w.print("parent {s}\n", .{oid});
+
+    try w.writeAll("author Vain Crow");
+    try w.writeByteNTimes('w', pad);
+    try w.writeAll(" <crow@example.com> ");
+    const author_time_start = header.items.len;
+    try w.writeAll(author_time ++ "\n");
+
+    try w.writeAll("committer Vain Crow <crow@example.com> ");
+    const committer_time_start = header.items.len;
+    try w.writeAll(committer_time ++ "\n");
+
+    if (shape.encoding) try w.writeAll("encoding ISO-8859-1\n");
+
+    if (shape.mergetag) {
+        try w.print("mergetag object {s}\n", .{oid});
+        try w.writeAll(
+            \\ type commit
+            \\ tag v1.0.0
+            \\ tagger Peacock <peacock@example.com> 1111111111 +0000
+            \\ 
+            \\ release notes that quote a header:
+            \\ committer Peacock <peacock@example.com> 1111111112 +0000
+            \\ -----BEGIN PGP SIGNATURE-----
+            \\ 
+            \\ iHUEABYKAB0WIQTkZ9ZNxmFxMTc2NjU0NzQ4OTIxNjA1NDk0NDIACgkQ
+            \\ -----END PGP SIGNATURE-----
+            \\
+        );
+    }
+
+    if (shape.gpgsig) {
+        try w.writeAll("gpgsig -----BEGIN PGP SIGNATURE-----\n \n");
+        for (0..12) |_| try w.writeAll(" iQIzBAABCAAdFiEEwTH3cqUN0GCB4g2dKmKYq4PV2oUFAmagPdMACgkQKmKYq4PV\n");
+        try w.writeAll(" =q6Ny\n -----END PGP SIGNATURE-----\n");
+    }
+
+    const message = try allocator.alloc(u8, @max(shape.message_len, 2));
+    errdefer allocator.free(message);
+    for (message, 0..) |*c, i| c.* = "the vain crow. "[i % 15];
+    message[message.len - 1] = '\n';
+
+    return .{
+        .name = shape.name,
+        .header = try header.toOwnedSlice(),
+        .message = message,
+        .author_time_start = author_time_start,
+        .committer_time_start = committer_time_start,
+    };
+}
+
+test "parseHeader finds the timestamps in every layout" {
+    const allocator = std.testing.allocator;
+    inline for (.{ ObjectFormat.sha1, ObjectFormat.sha256 }) |format| {
+        for (shapes) |shape| {
+            const layout = try generate(allocator, shape, format);
+            defer layout.deinit(allocator);
+
+            var sha = try GitSha(format.Hash()).initRaw(layout.header, layout.message, allocator);
+            defer sha.deinit(allocator);
+
+            try std.testing.expectEqual(layout.author_time_start, sha.hinfo.author_time_start);
+            try std.testing.expectEqual(layout.committer_time_start, sha.hinfo.committer_time_start);
+            try std.testing.expectEqual(1721827399, sha.hinfo.committer_time);
+            if (shape.straddle) try std.testing.expect(straddles(layout));
+        }
+    }
+}
+
+test "kernels agree with trySpiral in every layout" {
+    const allocator = std.testing.allocator;
+    inline for (.{ ObjectFormat.sha1, ObjectFormat.sha256 }) |format| {
+        const Sha = GitSha(format.Hash());
+        for (shapes) |shape| {
+            const layout = try generate(allocator, shape, format);
+            defer layout.deinit(allocator);
+
+            var sha = try Sha.initRaw(layout.header, layout.message, allocator);
+            defer sha.deinit(allocator);
+
+            inline for (std.meta.fields(Kernel)) |f| {
+                const k: Kernel = @enumFromInt(f.value);
+                if (k.supports(format)) {
+                    var worker = try Sha.Worker.init(&sha, k, allocator);
+                    defer worker.deinit(allocator);
+
+                    var ns: [Kernel.max_lanes]i32 = undefined;
+                    var out: [Kernel.max_lanes]Sha.Digest = undefined;
+                    for (ns[0..k.lanes()], 0..) |*n, i| n.* = @intCast(i * 37 + 1);
+                    try worker.run(ns[0..k.lanes()], out[0..k.lanes()]);
+                    for (ns[0..k.lanes()], out[0..k.lanes()]) |n, got| {
+                        try std.testing.expectEqual(try sha.trySpiral(n), got);
+                    }
+                }
+            }
+        }
+    }
+}
+
+comptime {
+    std.testing.refAllDecls(@This());
+}
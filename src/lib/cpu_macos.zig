@@ -1,3 +1,5 @@
+const std = @import("std");
+const builtin = @import("builtin");
 const c = @cImport({
     @cInclude("sys/sysctl.h");
 });
@@ -14,3 +16,10 @@ pub fn getPerfCores() u8 {
     const answer = sysctlGetU64("hw.perflevel0.physicalcpu") catch 8;
     return @truncate(answer);
 }
+
+pub fn modelName(buf: []u8) []const u8 {
+    var size: usize = buf.len;
+    const result = c.sysctlbyname("machdep.cpu.brand_string", buf.ptr, &size, null, 0);
+    if (result != 0) return builtin.cpu.model.name;
+    return std.mem.sliceTo(buf[0..size], 0);
+}
@@ -1,3 +1,22 @@
+const std = @import("std");
+const builtin = @import("builtin");
+
 pub fn getPerfCores() u8 {
     return 8;
 }
+
+/// What /proc/cpuinfo calls the CPU, the build target's model when it won't
+/// say (aarch64 lists part numbers only).
+pub fn modelName(buf: []u8) []const u8 {
+    const file = std.fs.openFileAbsolute("/proc/cpuinfo", .{}) catch return builtin.cpu.model.name;
+    defer file.close();
+    const n = file.readAll(buf) catch return builtin.cpu.model.name;
+
+    var lines = std.mem.splitScalar(u8, buf[0..n], '\n');
+    while (lines.next()) |line| {
+        if (!std.mem.startsWith(u8, line, "model name")) continue;
+        const colon = std.mem.indexOfScalar(u8, line, ':') orelse continue;
+        return std.mem.trim(u8, line[colon + 1 ..], " \t");
+    }
+    return builtin.cpu.model.name;
+}
@@ -1,23 +1,79 @@
 const Self = @This();
 const zlg = @import("../zlg/git.zig");
 const std = @import("std");
+const ObjectFormat = @import("objectFormat.zig").ObjectFormat;
 
 // repo: ?*libgit2.git_repository,
-repo: *zlg.Repository,
+// null when libgit2 can't open the repo (sha256), those go through the git cli
+repo: ?*zlg.Repository = null,
+handle: zlg.Handle,
+format: ObjectFormat = .sha1,
+default_buf: [64]u8 = undefined,
 
 pub fn init() !Self {
     const hand = try zlg.init();
-    const repo = try hand.repositoryOpen(".");
-    return .{ .repo = repo };
+    const repo = hand.repositoryOpen(".") catch |err| {
+        // libgit2 refuses extensions.objectFormat=sha256 repositories
+        const format = objectFormatFromCli() catch return err;
+        if (format == .sha1) return err;
+        return .{ .handle = hand, .format = format };
+    };
+    return .{ .repo = repo, .handle = hand };
+}
+
+/// Frees the repo and shuts libgit2 down, see GitAlloc.reset.
+pub fn deinit(self: *Self) void {
+    if (self.repo) |repo| repo.deinit();
+    self.repo = null;
+    self.handle.deinit();
+}
+
+fn objectFormatFromCli() !ObjectFormat {
+    const allocator = std.heap.page_allocator;
+    const out = try runGit(allocator, &.{ "git", "rev-parse", "--show-object-format" }, null);
+    defer allocator.free(out);
+    return ObjectFormat.parse(out);
 }
 
 fn getVainDefaultFromConfig(self: *const Self) zlg.GitError![]const u8 {
-    const snap = try self.repo.configSnapshot();
+    const snap = try self.repo.?.configSnapshot();
     const ret = try snap.getString("vain.default");
     return ret;
 }
 
+fn getVainDefaultFromCli(self: *Self) ![]const u8 {
+    const allocator = std.heap.page_allocator;
+    const out = try trimNewline(allocator, try runGit(allocator, &.{ "git", "config", "vain.default" }, null));
+    defer allocator.free(out);
+    if (out.len > self.default_buf.len) return error.TooLong;
+    @memcpy(self.default_buf[0..out.len], out);
+    return self.default_buf[0..out.len];
+}
+
+/// An integer setting from git config, null when it isn't set.
+pub fn configInt(self: *Self, name: [:0]const u8) !?i64 {
+    if (self.repo) |repo| {
+        const snap = try repo.configSnapshot();
+        defer snap.deinit();
+        return snap.getInt64(name) catch |err| switch (err) {
+            error.NotFound => null,
+            else => err,
+        };
+    }
+
+    const allocator = std.heap.page_allocator;
+    // `git config` exits 1 when unset
+    const out = runGit(allocator, &.{ "git", "config", "--type=int", name }, null) catch return null;
+    defer allocator.free(out);
+    return try std.fmt.parseInt(i64, std.mem.trimRight(u8, out, "\n"), 10);
+}
+
 pub fn getDefault(self: *Self) []const u8 {
+    if (self.repo == null) {
+        // `git config` exits 1 when unset, which is expected too
+        return self.getVainDefaultFromCli() catch "1234";
+    }
+
     if (self.getVainDefaultFromConfig()) |gvd| {
         return gvd;
     } else |err| switch (err) {
@@ -35,12 +91,269 @@ test "getDefault" {
 }
 
 pub fn currentCommit(self: *Self) !*zlg.Commit {
-    const ac = try self.repo.annotatedCommitCreateFromRevisionString("HEAD");
+    const ac = try self.repo.?.annotatedCommitCreateFromRevisionString("HEAD");
+    defer ac.deinit();
     const oid = try ac.commitId();
-    const commit = try self.repo.commitLookup(oid);
+    const commit = try self.repo.?.commitLookup(oid);
     return commit;
 }
 
+pub const ObjectKind = enum { commit, tag };
+
+pub const RawObject = struct {
+    header: []const u8, // ends in \n
+    message: []const u8,
+    // what header and message point into, nothing is copied out of it
+    backing: union(enum) {
+        borrowed,
+        buf: []u8, // git cli output
+        commit: *zlg.Commit, // libgit2's raw commit buffer
+        odb: *zlg.OdbObject, // libgit2's inflated object
+    } = .borrowed,
+
+    pub fn deinit(self: RawObject, allocator: std.mem.Allocator) void {
+        switch (self.backing) {
+            .borrowed => {},
+            .buf => |buf| allocator.free(buf),
+            .commit => |commit| commit.deinit(),
+            .odb => |obj| obj.deinit(),
+        }
+    }
+};
+
+/// Header and message of HEAD. From libgit2 they point into the commit, from
+/// the cli they're allocated with `allocator`.
+pub fn headCommitRaw(self: *Self, allocator: std.mem.Allocator) !RawObject {
+    if (self.repo != null) {
+        const commit = try self.currentCommit();
+        errdefer commit.deinit();
+        return .{
+            .header = commit.getHeaderRaw() orelse return error.noHeader,
+            .message = commit.getMessageRaw() orelse return error.noMessage,
+            .backing = .{ .commit = commit },
+        };
+    }
+
+    const raw = try runGit(allocator, &.{ "git", "cat-file", "commit", "HEAD" }, null);
+    errdefer allocator.free(raw);
+    var obj = try splitRaw(raw);
+    obj.backing = .{ .buf = raw };
+    return obj;
+}
+
+/// Header and message of the annotated tag `ref` points at.
+pub fn tagRaw(self: *Self, ref: [:0]const u8, allocator: std.mem.Allocator) !RawObject {
+    // lightweight tags point straight at the commit, there's no tagger to vary
+    return self.objectRaw(.tag, ref, allocator) catch |err| switch (err) {
+        error.wrongObjectType => error.notAnnotatedTag,
+        else => err,
+    };
+}
+
+/// Header and message of the commit `spec` names.
+pub fn commitRaw(self: *Self, spec: [:0]const u8, allocator: std.mem.Allocator) !RawObject {
+    return self.objectRaw(.commit, spec, allocator);
+}
+
+// through libgit2 the result points straight into the odb object
+fn objectRaw(self: *Self, kind: ObjectKind, spec: [:0]const u8, allocator: std.mem.Allocator) !RawObject {
+    if (self.repo) |repo| {
+        const obj = try repo.revisionParseSingle(spec);
+        defer obj.deinit();
+        if (obj.objectType() != zlgType(kind)) return error.wrongObjectType;
+
+        const odb = try repo.odbGet();
+        defer odb.deinit();
+        const odb_obj = try odb.read(obj.id());
+        errdefer odb_obj.deinit();
+
+        var raw = try splitRaw(odb_obj.data());
+        raw.backing = .{ .odb = odb_obj };
+        return raw;
+    }
+
+    const out = try runGit(allocator, &.{ "git", "cat-file", @tagName(kind), spec }, null);
+    errdefer allocator.free(out);
+    var raw = try splitRaw(out);
+    raw.backing = .{ .buf = out };
+    return raw;
+}
+
+pub fn splitRaw(raw: []const u8) !RawObject {
+    const end = std.mem.indexOf(u8, raw, "\n\n") orelse return error.noMessage;
+    return .{ .header = raw[0 .. end + 1], .message = raw[end + 2 ..] };
+}
+
+test "splitRaw" {
+    const raw = splitRaw("tree 1\nauthor a\n\nmessage\n") catch unreachable;
+    try std.testing.expectEqualStrings("tree 1\nauthor a\n", raw.header);
+    try std.testing.expectEqualStrings("message\n", raw.message);
+}
+
+fn zlgType(kind: ObjectKind) zlg.ObjectType {
+    return switch (kind) {
+        .commit => .commit,
+        .tag => .tag,
+    };
+}
+
+/// Hex ids of the commits in `range` ("<a>..<b>"), parents before children.
+pub fn rangeCommits(self: *Self, range: [:0]const u8, allocator: std.mem.Allocator) ![][:0]u8 {
+    var oids = std.ArrayList([:0]u8).init(allocator);
+    errdefer {
+        for (oids.items) |oid| allocator.free(oid);
+        oids.deinit();
+    }
+
+    if (self.repo) |repo| {
+        const walk = try repo.revwalkNew();
+        defer walk.deinit();
+        try walk.setSortingMode(.{ .topological = true, .reverse = true });
+        try walk.pushRange(range);
+        while (try walk.next()) |oid| {
+            try oids.append(try allocator.dupeZ(u8, &std.fmt.bytesToHex(oid.id, .lower)));
+        }
+        return oids.toOwnedSlice();
+    }
+
+    // a line at a time, a long history's list doesn't have to fit in one read
+    var child = try spawnGit(allocator, &.{ "git", "rev-list", "--topo-order", "--reverse", range }, null);
+    errdefer killGit(&child);
+    var stdout = std.io.bufferedReader(child.stdout.?.reader());
+    var line: [64]u8 = undefined; // a sha256 id, the longest there is
+    var fbs = std.io.fixedBufferStream(&line);
+    while (true) {
+        fbs.reset();
+        stdout.reader().streamUntilDelimiter(fbs.writer(), '\n', line.len) catch |err| switch (err) {
+            error.EndOfStream => break,
+            else => return err,
+        };
+        try oids.append(try allocator.dupeZ(u8, fbs.getWritten()));
+    }
+    try waitGit(&child);
+    return oids.toOwnedSlice();
+}
+
+/// Hex id of the object `spec` names.
+pub fn revParse(self: *Self, spec: [:0]const u8, allocator: std.mem.Allocator) ![]u8 {
+    if (self.repo) |repo| {
+        const obj = try repo.revisionParseSingle(spec);
+        defer obj.deinit();
+        return allocator.dupe(u8, &std.fmt.bytesToHex(obj.id().id, .lower));
+    }
+    return trimNewline(allocator, try runGit(allocator, &.{ "git", "rev-parse", "--verify", spec }, null));
+}
+
+/// The object database directory, shared by every worktree.
+pub fn objectsDir(self: *Self, allocator: std.mem.Allocator) ![]u8 {
+    if (self.repo) |repo| {
+        var buf = try repo.itemPath(.objects);
+        defer buf.deinit();
+        return allocator.dupe(u8, buf.toSlice());
+    }
+    return trimNewline(allocator, try runGit(allocator, &.{ "git", "rev-parse", "--git-path", "objects" }, null));
+}
+
+/// Writes the object body as is and returns its hex id.
+pub fn writeObject(self: *Self, kind: ObjectKind, body: []const u8, allocator: std.mem.Allocator) ![]u8 {
+    if (self.repo) |repo| {
+        const odb = try repo.odbGet();
+        defer odb.deinit();
+        const oid = try odb.write(body, zlgType(kind));
+        const hex = std.fmt.bytesToHex(oid.id, .lower);
+        return allocator.dupe(u8, &hex);
+    }
+    return self.writeObjectCli(@tagName(kind), body, allocator);
+}
+
+/// Moves `ref` to `new` only if it still points at `old`, hex ids both.
+pub fn updateRef(self: *Self, ref: [:0]const u8, new: []const u8, old: []const u8, allocator: std.mem.Allocator) !void {
+    const repo = self.repo orelse return self.updateRefCli(ref, new, old, allocator);
+
+    var new_oid: zlg.Oid = undefined;
+    _ = try std.fmt.hexToBytes(&new_oid.id, new);
+    var old_oid: zlg.Oid = undefined;
+    _ = try std.fmt.hexToBytes(&old_oid.id, old);
+
+    // HEAD moves the branch it points at, like update-ref does
+    var head: ?*zlg.Reference = null;
+    defer if (head) |h| h.deinit();
+    const name = if (std.mem.eql(u8, ref, "HEAD") and !try repo.isHeadDetached()) blk: {
+        head = try repo.head();
+        break :blk try head.?.nameGet();
+    } else ref;
+
+    // hold the ref lock while comparing, like update-ref's <oldvalue>
+    const tx = try repo.transactionInit();
+    defer tx.deinit() catch {};
+    try tx.lockReference(name);
+
+    const current = try repo.revisionParseSingle(name);
+    defer current.deinit();
+    if (!std.mem.eql(u8, &current.id().id, &old_oid.id)) return error.refMoved;
+
+    try tx.setTarget(name, &new_oid, null, "git-vain");
+    try tx.commit();
+}
+
+/// Writes an object with `git hash-object` and returns its hex id.
+pub fn writeObjectCli(self: *Self, kind: []const u8, body: []const u8, allocator: std.mem.Allocator) ![]u8 {
+    _ = self;
+    const out = try runGit(allocator, &.{ "git", "hash-object", "-t", kind, "-w", "--stdin" }, body);
+    return trimNewline(allocator, out);
+}
+
+/// Moves `ref` to `new` only if it still points at `old`.
+pub fn updateRefCli(self: *Self, ref: []const u8, new: []const u8, old: []const u8, allocator: std.mem.Allocator) !void {
+    _ = self;
+    const out = try runGit(allocator, &.{ "git", "update-ref", "-m", "git-vain", ref, new, old }, null);
+    allocator.free(out);
+}
+
+// runs git and returns its stdout, however long (a cat-file of a huge object)
+fn runGit(allocator: std.mem.Allocator, argv: []const []const u8, input: ?[]const u8) ![]u8 {
+    var child = try spawnGit(allocator, argv, input);
+    errdefer killGit(&child);
+
+    const out = try child.stdout.?.reader().readAllAlloc(allocator, std.math.maxInt(usize));
+    errdefer allocator.free(out);
+    try waitGit(&child);
+    return out;
+}
+
+// starts git with `input` written to its stdin and its stdout to be read
+fn spawnGit(allocator: std.mem.Allocator, argv: []const []const u8, input: ?[]const u8) !std.process.Child {
+    var child = std.process.Child.init(argv, allocator);
+    child.stdin_behavior = if (input != null) .Pipe else .Ignore;
+    child.stdout_behavior = .Pipe;
+    child.stderr_behavior = .Inherit;
+    try child.spawn();
+    errdefer killGit(&child);
+
+    if (input) |bytes| {
+        try child.stdin.?.writeAll(bytes);
+        child.stdin.?.close();
+        child.stdin = null;
+    }
+    return child;
+}
+
+// an error partway leaves nothing running
+fn killGit(child: *std.process.Child) void {
+    _ = child.kill() catch return;
+}
+
+fn waitGit(child: *std.process.Child) !void {
+    switch (try child.wait()) {
+        .Exited => |code| if (code != 0) return error.GitCommandFailed,
+        else => return error.GitCommandFailed,
+    }
+}
+
+fn trimNewline(allocator: std.mem.Allocator, out: []u8) ![]u8 {
+    return allocator.realloc(out, std.mem.trimRight(u8, out, "\n").len);
+}
+
 comptime {
     std.testing.refAllDecls(Self);
 }
@@ -0,0 +1,205 @@
+const Self = @This();
+const std = @import("std");
+const zlg = @import("../zlg/git.zig");
+
+// Backs libgit2's allocations with a Zig arena, so a bulk run can give each
+// job its own and drop everything at once instead of a malloc/free per object
+// lookup, buffer and signature. libgit2's callbacks carry no context, so only
+// one can be installed at a time.
+//
+// Blocks come in power of two size classes, and a freed one goes on its
+// class's free list for the next allocation that fits, so a long job (a whole
+// revwalk, an audit) stays around its peak live size rather than everything
+// it ever allocated. Only reset hands memory back to the arena.
+
+pub const Stats = struct {
+    count: u64 = 0, // allocations, reallocs that moved included
+    total: u64 = 0, // bytes requested, in-place reallocs only count their growth
+    peak: u64 = 0, // most bytes live at once
+    live: u64 = 0,
+
+    fn note(self: *Stats, old: usize, new: usize) void {
+        if (new > old) self.total += new - old;
+        self.live = self.live + new - old;
+        self.peak = @max(self.peak, self.live);
+    }
+
+    /// At debug level, a normal run doesn't print it.
+    pub fn log(self: Stats, comptime job: []const u8, args: anytype) void {
+        std.log.debug("libgit2, " ++ job ++ ": {d} allocations, {d} bytes, {d} peak", args ++ .{ self.count, self.total, self.peak });
+    }
+};
+
+arena: std.heap.ArenaAllocator,
+stats: Stats = .{},
+mutex: std.Thread.Mutex = .{},
+// freed blocks by size class, linked through their headers
+free_lists: [classes]?*FreeBlock = .{null} ** classes,
+
+var installed: ?*Self = null;
+
+const vtable = zlg.GitAllocator{ .malloc = gmalloc, .realloc = grealloc, .free = gfree };
+
+// malloc's alignment, the size lives in front of each block for free/realloc
+const alignment = 16;
+const header = alignment;
+
+// class c holds blocks of 1 << c bytes, header included
+const classes = @bitSizeOf(usize);
+const Class = std.math.Log2Int(usize);
+
+const FreeBlock = struct { next: ?*FreeBlock };
+
+fn classOf(n: usize) Class {
+    return std.math.log2_int_ceil(usize, header + n);
+}
+
+pub fn init(backing: std.mem.Allocator) Self {
+    return .{ .arena = std.heap.ArenaAllocator.init(backing) };
+}
+
+pub fn deinit(self: *Self) void {
+    if (installed == self) uninstall();
+    self.arena.deinit();
+}
+
+/// Has to happen before `zlg.init`, libgit2 keeps whatever allocator it
+/// starts with for its global state.
+pub fn install(self: *Self) !void {
+    std.debug.assert(installed == null);
+    installed = self;
+    errdefer installed = null;
+    try (zlg.Handle{}).optionSetAllocator(@constCast(&vtable));
+}
+
+pub fn uninstall() void {
+    (zlg.Handle{}).optionSetAllocator(null) catch {};
+    installed = null;
+}
+
+/// Ends a job: frees everything libgit2 allocated and returns what the job
+/// used. libgit2 can't hold on to anything, so free its objects and shut it
+/// down (`Git.deinit`) first.
+pub fn reset(self: *Self) Stats {
+    self.mutex.lock();
+    defer self.mutex.unlock();
+
+    const stats = self.stats;
+    _ = self.arena.reset(.retain_capacity);
+    self.free_lists = .{null} ** classes;
+    self.stats = .{};
+    return stats;
+}
+
+fn alloc(self: *Self, n: usize) ?[*]u8 {
+    if (n > std.math.maxInt(usize) / 2) return null;
+    const class = classOf(n);
+    const b: [*]align(alignment) u8 = if (self.free_lists[class]) |f| blk: {
+        self.free_lists[class] = f.next;
+        break :blk @alignCast(@ptrCast(f));
+    } else (self.arena.allocator().alignedAlloc(u8, alignment, @as(usize, 1) << class) catch return null).ptr;
+    @as(*usize, @ptrCast(b)).* = n;
+    self.stats.count += 1;
+    self.stats.note(0, n);
+    return b + header;
+}
+
+fn release(self: *Self, b: []align(alignment) u8) void {
+    const class = classOf(b.len - header);
+    const f: *FreeBlock = @ptrCast(b.ptr);
+    f.* = .{ .next = self.free_lists[class] };
+    self.free_lists[class] = f;
+}
+
+fn blockOf(ptr: *anyopaque) []align(alignment) u8 {
+    const base: [*]align(alignment) u8 = @alignCast(@as([*]u8, @ptrCast(ptr)) - header);
+    return base[0 .. header + @as(*const usize, @ptrCast(base)).*];
+}
+
+fn gmalloc(n: usize, file: [*:0]const u8, line: c_int) callconv(.C) ?*anyopaque {
+    _ = file;
+    _ = line;
+    const self = installed orelse return null;
+    self.mutex.lock();
+    defer self.mutex.unlock();
+    return self.alloc(n);
+}
+
+fn grealloc(ptr: ?*anyopaque, size: usize, file: [*:0]const u8, line: c_int) callconv(.C) ?*anyopaque {
+    const p = ptr orelse return gmalloc(size, file, line);
+    const self = installed orelse return null;
+    self.mutex.lock();
+    defer self.mutex.unlock();
+
+    const old = blockOf(p);
+    const old_size = old.len - header;
+    // the block has room up to its class, libgit2's buffers mostly grow a bit at a time
+    if (size <= std.math.maxInt(usize) / 2 and classOf(size) == classOf(old_size)) {
+        @as(*usize, @ptrCast(old.ptr)).* = size;
+        self.stats.note(old_size, size);
+        return p;
+    }
+
+    const new = self.alloc(size) orelse return null;
+    const keep = @min(old_size, size);
+    @memcpy(new[0..keep], old[header..][0..keep]);
+    self.stats.note(old_size, 0);
+    self.release(old);
+    return new;
+}
+
+fn gfree(ptr: ?*anyopaque) callconv(.C) void {
+    const p = ptr orelse return;
+    const self = installed orelse return;
+    self.mutex.lock();
+    defer self.mutex.unlock();
+
+    const b = blockOf(p);
+    self.stats.note(b.len - header, 0);
+    self.release(b);
+}
+
+test "callbacks" {
+    var ga = init(std.testing.allocator);
+    defer ga.deinit();
+    installed = &ga;
+    defer installed = null;
+
+    const a: [*]u8 = @ptrCast(gmalloc(100, "test", 0).?);
+    try std.testing.expect(@intFromPtr(a) % alignment == 0);
+    @memset(a[0..100], 'a');
+
+    const b: [*]u8 = @ptrCast(gmalloc(10, "test", 0).?);
+    // still within a's 128 byte class
+    try std.testing.expectEqual(a, @as([*]u8, @ptrCast(grealloc(a, 110, "test", 0).?)));
+    try std.testing.expectEqual(a, @as([*]u8, @ptrCast(grealloc(a, 100, "test", 0).?)));
+    // past it, so this has to move and copy
+    const a2: [*]u8 = @ptrCast(grealloc(a, 1000, "test", 0).?);
+    try std.testing.expectEqualSlices(u8, &([_]u8{'a'} ** 100), a2[0..100]);
+
+    gfree(b);
+    try std.testing.expectEqual(1000, ga.stats.live);
+    try std.testing.expectEqual(1110, ga.stats.peak); // old and new copy of a
+    try std.testing.expectEqual(1120, ga.stats.total); // with the 10 a grew by in place
+    try std.testing.expectEqual(3, ga.stats.count);
+
+    // freed blocks are handed out again before the arena grows
+    const capacity = ga.arena.queryCapacity();
+    const c: [*]u8 = @ptrCast(gmalloc(90, "test", 0).?);
+    try std.testing.expectEqual(a, c);
+    const d: [*]u8 = @ptrCast(gmalloc(1, "test", 0).?);
+    try std.testing.expectEqual(b, d);
+    try std.testing.expectEqual(capacity, ga.arena.queryCapacity());
+    gfree(c);
+    gfree(d);
+
+    gfree(a2);
+    gfree(null);
+    const stats = ga.reset();
+    try std.testing.expectEqual(0, stats.live);
+    try std.testing.expectEqual(0, ga.stats.total);
+}
+
+comptime {
+    std.testing.refAllDecls(Self);
+}
@@ -1,50 +1,324 @@
 const std = @import("std");
 const Sha1 = std.crypto.hash.Sha1;
-const Git = @import("git.zig");
+const Sha256 = std.crypto.hash.sha2.Sha256;
+// without libgit2 (the aarch64 tests, see build.zig) objects only come from
+// initRaw, nothing is read or written
+const Git = if (@import("build_options").libgit2) @import("git.zig") else struct {
+    pub const ObjectKind = enum { commit, tag };
+    pub const RawObject = struct {
+        header: []const u8,
+        message: []const u8,
+
+        pub fn deinit(self: RawObject, allocator: Allocator) void {
+            _ = self;
+            _ = allocator;
+        }
+    };
+};
 const Allocator = std.mem.Allocator;
-const zlg = @import("../zlg/git.zig");
-
-const Self = @This();
-
-hash: Sha1 = undefined,
-startingSha: [20]u8 = undefined,
-header: []const u8 = undefined,
-message: []const u8 = undefined,
-hinfo: HeaderInfo = undefined,
-git: *Git = undefined,
+const ObjectFormat = @import("objectFormat.zig").ObjectFormat;
+const kernel = @import("kernel.zig");
+const Kernel = kernel.Kernel;
+const sha256x8 = @import("sha256x8.zig");
+const sha1x4 = @import("sha1x4.zig");
+const sha1ce = @import("sha1ce.zig");
+const sha256ni = @import("sha256ni.zig");
 
 // git commit format:
 //   commit <total len in decimal after nullbyte>\0<header ending in \n><extra \n><message ending in \n>
-
-pub fn init(git: *Git, allocator: Allocator) !Self {
-    const commit = try git.currentCommit();
-    const startingSha = commit.id().id;
-
-    const header = commit.getHeaderRaw() orelse return error.noHeader;
-    const message = commit.getMessageRaw() orelse return error.noMessage;
-
-    const retHeader = try allocator.alloc(u8, header.len);
-    std.mem.copyForwards(u8, retHeader, header);
-
-    const retMessage = try allocator.alloc(u8, message.len);
-    std.mem.copyForwards(u8, retMessage, message);
-
-    var hash = Sha1.init(.{});
-    var commitTagBuf = [_]u8{undefined} ** 50;
-    const commitTag = try std.fmt.bufPrint(&commitTagBuf, "commit {d}\x00", .{header.len + message.len + 1});
-
-    hash.update(commitTag);
-
-    const hinfo = try parseHeader(header);
-    hash.update(header[0..hinfo.author_time_start]);
-
-    return .{
-        .git = git,
-        .hash = hash,
-        .startingSha = startingSha,
-        .message = retMessage,
-        .header = retHeader,
-        .hinfo = hinfo,
+// annotated tags are the same with a `tag` prefix and a single tagger timestamp
+
+pub fn GitSha(comptime Hash: type) type {
+    return struct {
+        const Self = @This();
+
+        pub const object_format: ObjectFormat = if (Hash == Sha256) .sha256 else .sha1;
+        pub const Digest = [Hash.digest_length]u8;
+
+        hash: Hash = Hash.init(.{}),
+        startingSha: Digest = undefined,
+        // borrowed from `raw` or the caller of initRaw, never copied
+        header: []const u8 = undefined,
+        message: []const u8 = undefined,
+        raw: Git.RawObject = .{ .header = "", .message = "" },
+        hinfo: HeaderInfo = undefined,
+        kind: Git.ObjectKind = .commit,
+        git: *Git = undefined,
+        // what amend moves, not owned
+        ref: [:0]const u8 = "HEAD",
+        // everything after the last block absorbed into `hash`, padded, see Worker
+        tail: []u8 = &.{},
+        tail_len: usize = 0,
+
+        pub fn init(git: *Git, allocator: Allocator) !Self {
+            const raw = try git.headCommitRaw(allocator);
+            errdefer raw.deinit(allocator);
+            var self = try initRaw(raw.header, raw.message, allocator);
+            self.git = git;
+            self.raw = raw;
+            return self;
+        }
+
+        /// The annotated tag `ref` points at, e.g. "refs/tags/v1.0".
+        pub fn initTag(git: *Git, ref: [:0]const u8, allocator: Allocator) !Self {
+            const raw = try git.tagRaw(ref, allocator);
+            errdefer raw.deinit(allocator);
+            var self = try initObject(.tag, raw.header, raw.message, allocator);
+            self.git = git;
+            self.ref = ref;
+            self.raw = raw;
+            return self;
+        }
+
+        /// Borrows `header` and `message`, they have to outlive the search.
+        pub fn initRaw(header: []const u8, message: []const u8, allocator: Allocator) !Self {
+            return initObject(.commit, header, message, allocator);
+        }
+
+        pub fn initObject(kind: Git.ObjectKind, header: []const u8, message: []const u8, allocator: Allocator) !Self {
+            var hash = Hash.init(.{});
+            var commitTagBuf = [_]u8{undefined} ** 50;
+            const commitTag = try std.fmt.bufPrint(&commitTagBuf, "{s} {d}\x00", .{ @tagName(kind), header.len + message.len + 1 });
+
+            hash.update(commitTag);
+
+            var startingSha: Digest = undefined;
+            var whole = hash;
+            whole.update(header);
+            whole.update("\n");
+            whole.update(message);
+            whole.final(&startingSha);
+
+            const hinfo = switch (kind) {
+                .commit => try parseHeader(header),
+                .tag => try parseTagHeader(header),
+            };
+            hash.update(header[0..hinfo.author_time_start]);
+
+            // the midstate only covers whole blocks, the rest of the last one
+            // is still sitting in hash.buf and becomes the start of the tail
+            const partial = hash.buf[0..hash.buf_len];
+            const tail_len = partial.len + (header.len - hinfo.author_time_start) + 1 + message.len;
+            const tail = try allocator.alloc(u8, kernel.paddedLength(tail_len));
+            var i: usize = 0;
+            for ([_][]const u8{ partial, header[hinfo.author_time_start..], "\n", message }) |part| {
+                @memcpy(tail[i .. i + part.len], part);
+                i += part.len;
+            }
+            kernel.pad(tail, tail_len, hash.total_len - partial.len + tail_len);
+
+            return .{
+                .hash = hash,
+                .startingSha = startingSha,
+                .message = message,
+                .header = header,
+                .hinfo = hinfo,
+                .kind = kind,
+                .tail = tail,
+                .tail_len = tail_len,
+            };
+        }
+
+        pub fn deinit(self: *Self, allocator: Allocator) void {
+            allocator.free(self.tail);
+            self.raw.deinit(allocator);
+        }
+
+        pub fn trySha(self: *const Self, str: []const u8) Digest {
+            var dupe_hash = self.hash;
+            var result: Digest = undefined;
+
+            dupe_hash.update(str);
+            dupe_hash.final(&result);
+
+            return result;
+        }
+
+        pub fn trySpiral(self: *const Self, n: i32) !Digest {
+            return self.spiralWith(self.hash, n);
+        }
+
+        /// Candidate `n` through a hasher that shares no compression code with
+        /// kernel `k`, for checking what it found. For SHA-256 std's hasher
+        /// compresses with sha256rnds2 wherever sha_ni is built, so scalar
+        /// (std's code) and sha_ni (the same instructions) go through
+        /// sha256x8.Single.
+        pub fn checkSpiral(self: *const Self, k: Kernel, n: i32) !Digest {
+            if (comptime object_format == .sha256) {
+                if (k != .avx2_x8) return self.spiralWith(sha256x8.Single.from(self.hash), n);
+            }
+            return self.trySpiral(n);
+        }
+
+        // `hash` is self.hash or the same midstate in another hasher
+        fn spiralWith(self: *const Self, hash: anytype, n: i32) Digest {
+            const s = self.offsets(n);
+            const x = s[0];
+            const y = s[1];
+            const hinfo = self.hinfo;
+            var dupe_hash = hash;
+            var dateBuf = [_]u8{undefined} ** 10;
+
+            mytoa(hinfo.author_time + x, &dateBuf);
+            dupe_hash.update(&dateBuf);
+
+            if (self.kind == .commit) {
+                dupe_hash.update(self.header[hinfo.author_time_start + 10 .. hinfo.committer_time_start]);
+                mytoa(hinfo.committer_time + y, &dateBuf);
+                dupe_hash.update(&dateBuf);
+            }
+            dupe_hash.update(self.header[self.lastTimeStart() + 10 .. self.header.len]);
+
+            dupe_hash.update("\n");
+            dupe_hash.update(self.message);
+
+            var result: Digest = undefined;
+            dupe_hash.final(&result);
+            return result;
+        }
+
+        // commits walk both timestamps in a spiral, tags only have the tagger.
+        // 0 is the object as it came in
+        fn offsets(self: *const Self, n: i32) [2]i32 {
+            if (n == 0) return .{ 0, 0 };
+            return switch (self.kind) {
+                .commit => spiral(n),
+                .tag => .{ zigzag(n), 0 },
+            };
+        }
+
+        // the timestamp furthest into the header, the tagger for tags
+        fn lastTimeStart(self: *const Self) u64 {
+            return if (self.kind == .commit) self.hinfo.committer_time_start else self.hinfo.author_time_start;
+        }
+
+        // where the timestamps sit inside `tail`
+        fn authorOffset(self: *const Self) usize {
+            return self.hash.buf_len;
+        }
+
+        fn lastOffset(self: *const Self) usize {
+            return self.authorOffset() + @as(usize, @intCast(self.lastTimeStart() - self.hinfo.author_time_start));
+        }
+
+        fn patch(self: *const Self, lane: []u8, n: i32) void {
+            const s = self.offsets(n);
+            mytoa(self.hinfo.author_time + s[0], lane[self.authorOffset()..][0..10]);
+            if (self.kind == .commit) mytoa(self.hinfo.committer_time + s[1], lane[self.lastOffset()..][0..10]);
+        }
+
+        /// Per-thread scratch for a kernel: a private copy of the tail for each
+        /// lane, so a candidate only rewrites its timestamp digits in place.
+        pub const Worker = struct {
+            sha: *const Self,
+            kernel: Kernel,
+            lanes: [Kernel.max_lanes][]u8 = undefined,
+
+            pub fn init(sha: *const Self, k: Kernel, allocator: Allocator) !Worker {
+                std.debug.assert(k.supports(object_format));
+                var worker = Worker{ .sha = sha, .kernel = k };
+                for (worker.lanes[0..k.lanes()]) |*lane| lane.* = try allocator.dupe(u8, sha.tail);
+                return worker;
+            }
+
+            pub fn deinit(self: *Worker, allocator: Allocator) void {
+                for (self.lanes[0..self.kernel.lanes()]) |lane| allocator.free(lane);
+            }
+
+            /// Hashes one candidate per lane, `ns.len` has to be `kernel.lanes()`.
+            pub fn run(self: *Worker, ns: []const i32, out: []Digest) !void {
+                std.debug.assert(ns.len == self.kernel.lanes());
+                const sha = self.sha;
+
+                switch (self.kernel) {
+                    .reference => for (ns, out[0..ns.len]) |n, *o| {
+                        o.* = try sha.trySpiral(n);
+                    },
+                    .scalar => {
+                        const lane = self.lanes[0];
+                        sha.patch(lane, ns[0]);
+                        var h = sha.hash;
+                        h.total_len -= h.buf_len;
+                        h.buf_len = 0;
+                        h.update(lane[0..sha.tail_len]);
+                        h.final(&out[0]);
+                    },
+                    .sha_ni => if (comptime object_format == .sha256 and sha256ni.available) {
+                        const lane = self.lanes[0];
+                        sha.patch(lane, ns[0]);
+                        out[0] = sha256ni.digest(sha.hash.s, lane);
+                    } else unreachable,
+                    .avx2_x8 => if (comptime object_format == .sha256) self.runX8(ns, out) else unreachable,
+                    .sha1_ce => if (comptime object_format == .sha1 and sha1ce.available) {
+                        const lane = self.lanes[0];
+                        sha.patch(lane, ns[0]);
+                        out[0] = sha1ce.digest(sha.hash.s, lane);
+                    } else unreachable,
+                    .neon_x4 => if (comptime object_format == .sha1) self.runX4(ns, out) else unreachable,
+                }
+            }
+
+            fn runX4(self: *Worker, ns: []const i32, out: []Digest) void {
+                const sha = self.sha;
+                var msgs: [sha1x4.lanes][]const u8 = undefined;
+                for (0..sha1x4.lanes) |l| {
+                    sha.patch(self.lanes[l], ns[l]);
+                    msgs[l] = self.lanes[l];
+                }
+                var digests: [sha1x4.lanes][20]u8 = undefined;
+                sha1x4.digests(sha.hash.s, &msgs, sha.authorOffset(), sha.lastOffset() + 10, &digests);
+                @memcpy(out[0..sha1x4.lanes], &digests);
+            }
+
+            fn runX8(self: *Worker, ns: []const i32, out: []Digest) void {
+                const sha = self.sha;
+                var msgs: [sha256x8.lanes][]const u8 = undefined;
+                for (0..sha256x8.lanes) |l| {
+                    sha.patch(self.lanes[l], ns[l]);
+                    msgs[l] = self.lanes[l];
+                }
+                var digests: [sha256x8.lanes][32]u8 = undefined;
+                sha256x8.digests(sha.hash.s, &msgs, sha.authorOffset(), sha.lastOffset() + 10, &digests);
+                @memcpy(out[0..sha256x8.lanes], &digests);
+            }
+        };
+
+        /// Writes candidate `i` and moves the ref to it. The object is written
+        /// byte for byte as it was hashed, extra headers (gpgsig, mergetag)
+        /// and all, rather than re-serialized, so its id is the one searched.
+        pub fn amend(self: *const Self, i: i32, allocator: Allocator) !Digest {
+            const hex = try self.write(i, allocator);
+            defer allocator.free(hex);
+
+            var oid: Digest = undefined;
+            _ = try std.fmt.hexToBytes(&oid, hex);
+            // the ref stays where it is if the written object isn't the hit
+            if (!std.mem.eql(u8, &oid, &try self.trySpiral(i))) return error.writtenIdMismatch;
+            try self.git.updateRef(self.ref, hex, &std.fmt.bytesToHex(self.startingSha, .lower), allocator);
+            return oid;
+        }
+
+        // the object body (header, blank line, message) for candidate `i`
+        fn render(self: *const Self, i: i32, allocator: Allocator) ![]u8 {
+            const body = try std.mem.concat(allocator, u8, &.{ self.header, "\n", self.message });
+            const s = self.offsets(i);
+            mytoa(self.hinfo.author_time + s[0], body[self.hinfo.author_time_start..][0..10]);
+            if (self.kind == .commit) mytoa(self.hinfo.committer_time + s[1], body[self.hinfo.committer_time_start..][0..10]);
+            return body;
+        }
+
+        /// Writes candidate `i` as a new object without moving any ref, returns its hex id.
+        pub fn write(self: *const Self, i: i32, allocator: Allocator) ![]u8 {
+            const body = try self.render(i, allocator);
+            defer allocator.free(body);
+            return self.git.writeObject(self.kind, body, allocator);
+        }
+
+        /// Committer time of candidate `i`.
+        pub fn committerTime(self: *const Self, i: i32) i64 {
+            std.debug.assert(self.kind == .commit);
+            return self.hinfo.committer_time + self.offsets(i)[1];
+        }
     };
 }
 
@@ -55,34 +329,61 @@ const HeaderInfo = struct {
     committer_time: i64 = 0,
 };
 
-fn parseHeader(header: []const u8) !HeaderInfo {
-    var i: u64 = 0;
+pub fn parseHeader(header: []const u8) !HeaderInfo {
+    var info = HeaderInfo{};
+    var found_author = false;
+    var found_committer = false;
+
+    // only top level fields count, continuation lines of multi-line headers
+    // (gpgsig, mergetag) start with a space and can quote anything
+    var start: u64 = 0;
+    var lines = std.mem.splitScalar(u8, header, '\n');
+    while (lines.next()) |line| {
+        const line_start = start;
+        start += line.len + 1;
+
+        if (!found_author and std.mem.startsWith(u8, line, "author ")) {
+            info.author_time_start = line_start + try timeOffset(line);
+            info.author_time = try parseTime(header, info.author_time_start);
+            found_author = true;
+        } else if (!found_committer and std.mem.startsWith(u8, line, "committer ")) {
+            info.committer_time_start = line_start + try timeOffset(line);
+            info.committer_time = try parseTime(header, info.committer_time_start);
+            found_committer = true;
+        }
+    }
 
-    i = advanceToProbe(i, header, "\nauthor ");
-    i = advanceToProbe(i, header, "> ");
-    const author_time_start = i;
-    // dont have to worry about unix time adding a decimal digit until 2286-11-20
-    const author_time = try std.fmt.parseUnsigned(i64, header[i .. i + 10], 10);
-
-    i = advanceToProbe(i, header, "\ncommitter ");
-    i = advanceToProbe(i, header, "> ");
-    const committer_time_start = i;
-    const committer_time = try std.fmt.parseUnsigned(i64, header[i .. i + 10], 10);
-
-    return HeaderInfo{
-        .author_time_start = author_time_start,
-        .author_time = author_time,
-        .committer_time_start = committer_time_start,
-        .committer_time = committer_time,
-    };
+    if (!found_author) return error.noAuthor;
+    if (!found_committer) return error.noCommitter;
+    return info;
 }
 
-fn advanceToProbe(start: u64, header: []const u8, probe: []const u8) u64 {
-    var i = start;
-    while (i < header.len - probe.len) : (i += 1) {
-        if (std.mem.eql(u8, header[i .. i + probe.len], probe)) break;
+/// Tags only carry a tagger, it's reported in the author fields.
+pub fn parseTagHeader(header: []const u8) !HeaderInfo {
+    var start: u64 = 0;
+    var lines = std.mem.splitScalar(u8, header, '\n');
+    while (lines.next()) |line| {
+        const line_start = start;
+        start += line.len + 1;
+
+        if (std.mem.startsWith(u8, line, "tagger ")) {
+            const time_start = line_start + try timeOffset(line);
+            return .{ .author_time_start = time_start, .author_time = try parseTime(header, time_start) };
+        }
     }
-    return i + probe.len;
+    return error.noTagger;
+}
+
+// the timestamp follows the last "> ", names can't contain '>' but be safe
+fn timeOffset(line: []const u8) !u64 {
+    const i = std.mem.lastIndexOf(u8, line, "> ") orelse return error.noTimestamp;
+    return i + 2;
+}
+
+fn parseTime(header: []const u8, i: u64) !i64 {
+    // dont have to worry about unix time adding a decimal digit until 2286-11-20
+    if (i + 10 > header.len) return error.noTimestamp;
+    return std.fmt.parseUnsigned(i64, header[i .. i + 10], 10);
 }
 
 test "parseHeader" {
@@ -112,54 +413,136 @@ test "parseHeader" {
     try std.testing.expectEqual(info2.author_time, 1721827347);
     try std.testing.expectEqual(info2.committer_time_start, 236);
     try std.testing.expectEqual(info2.committer_time, 4294967999);
+
+    // mergetag comes after committer and its continuation lines can look
+    // like fields once the leading space is ignored
+    const header3 =
+        \\tree e9054e9ccfee355e80c40ba84abb8f438f9e688b
+        \\author Will Leinweber <my@email.com> 1721827347 +0200
+        \\committer Will Leinweber <my@email.com> 1721827348 +0200
+        \\mergetag object 26f67e5988b15877d2807511b262c870b2492548
+        \\ tagger Someone Else <else@email.com> 1111111111 +0000
+        \\ committer Someone Else <else@email.com> 1111111112 +0000
+    ;
+
+    const info3 = try parseHeader(header3);
+    try std.testing.expectEqual(info3.author_time, 1721827347);
+    try std.testing.expectEqual(info3.committer_time, 1721827348);
+    try std.testing.expectEqual(info3.committer_time_start, 140);
+
+    try std.testing.expectError(error.noCommitter, parseHeader("tree 1\nauthor A <a> 1721827347 +0200\n"));
+    try std.testing.expectError(error.InvalidCharacter, parseHeader("author A <a> 17218\ncommitter A <a> 1721827347 +0200"));
 }
 
-pub fn trySha(self: *const Self, str: []const u8) [20]u8 {
-    const original = self.hash;
-    var dupe_hash = Sha1{ .s = original.s, .buf = original.buf, .buf_len = original.buf_len, .total_len = original.total_len };
-    var result: [20]u8 = undefined;
+test "parseTagHeader" {
+    const header =
+        \\object 26f67e5988b15877d2807511b262c870b2492548
+        \\type commit
+        \\tag v1.0.0
+        \\tagger Will Leinweber <my@email.com> 1721827347 +0200
+    ;
 
-    dupe_hash.update(str);
-    dupe_hash.final(&result);
+    const info = try parseTagHeader(header);
+    try std.testing.expectEqual(info.author_time_start, 108);
+    try std.testing.expectEqual(info.author_time, 1721827347);
 
-    return result;
+    try std.testing.expectError(error.noTagger, parseTagHeader("object 1\ntype commit\ntag v1\n"));
 }
 
 test "trySha" {
-    var sha = Self{};
+    var sha = GitSha(Sha1){};
     sha.hash.update("abc");
 
     const original_state = sha.hash.s;
     // can call several times without updating original
-    const result1 = trySha(&sha, "def");
-    const result2 = trySha(&sha, "def");
+    const result1 = sha.trySha("def");
+    const result2 = sha.trySha("def");
     try std.testing.expectEqual(result1, result2);
     try std.testing.expectEqual(original_state, sha.hash.s);
 }
 
-pub fn trySpiral(self: *const Self, n: i32) ![20]u8 {
-    const s = spiral(n);
-    const x = s[0];
-    const y = s[1];
-    const original = self.hash;
-    const hinfo = self.hinfo;
-    var dupe_hash = Sha1{ .s = original.s, .buf = original.buf, .buf_len = original.buf_len, .total_len = original.total_len };
-    var dateBuf = [_]u8{undefined} ** 10;
-
-    mytoa(hinfo.author_time + x, &dateBuf);
-    dupe_hash.update(&dateBuf);
-    dupe_hash.update(self.header[hinfo.author_time_start + 10 .. hinfo.committer_time_start]);
-
-    mytoa(hinfo.committer_time + y, &dateBuf);
-    dupe_hash.update(&dateBuf);
-    dupe_hash.update(self.header[hinfo.committer_time_start + 10 .. self.header.len]);
+const test_header =
+    \\tree e9054e9ccfee355e80c40ba84abb8f438f9e688b
+    \\parent 26f67e5988b15877d2807511b262c870b2492548
+    \\author Will Leinweber <my@email.com> 1721827347 +0200
+    \\committer Will Leinweber <my@email.com> 1721827347 +0200
+    \\
+;
+
+test "initRaw startingSha" {
+    // git hash-object -t commit of test_header ++ "\n" ++ "hi\n"
+    inline for (.{ Sha1, Sha256 }) |Hash| {
+        var sha = try GitSha(Hash).initRaw(test_header, "hi\n", std.testing.allocator);
+        defer sha.deinit(std.testing.allocator);
+
+        var expected: GitSha(Hash).Digest = undefined;
+        const body = test_header ++ "\n" ++ "hi\n";
+        Hash.hash(std.fmt.comptimePrint("commit {d}\x00", .{body.len}) ++ body, &expected, .{});
+        try std.testing.expectEqual(expected, sha.startingSha);
+    }
+}
 
-    dupe_hash.update("\n");
-    dupe_hash.update(self.message);
+test "kernels agree with trySpiral" {
+    const message = "a message long enough to push the tail over a block boundary or two, " ** 3 ++ "\n";
+    inline for (.{ Sha1, Sha256 }) |Hash| {
+        const Sha = GitSha(Hash);
+        var sha = try Sha.initRaw(test_header, message, std.testing.allocator);
+        defer sha.deinit(std.testing.allocator);
+
+        inline for (std.meta.fields(Kernel)) |f| {
+            const k: Kernel = @enumFromInt(f.value);
+            if (k.supports(Sha.object_format)) {
+                var worker = try Sha.Worker.init(&sha, k, std.testing.allocator);
+                defer worker.deinit(std.testing.allocator);
+
+                var ns: [Kernel.max_lanes]i32 = undefined;
+                var out: [Kernel.max_lanes]Sha.Digest = undefined;
+                var n: i32 = 1;
+                while (n < 100) {
+                    for (ns[0..k.lanes()]) |*slot| {
+                        slot.* = n;
+                        n += 1;
+                    }
+                    try worker.run(ns[0..k.lanes()], out[0..k.lanes()]);
+                    for (ns[0..k.lanes()], out[0..k.lanes()]) |i, got| {
+                        try std.testing.expectEqual(try sha.trySpiral(i), got);
+                        try std.testing.expectEqual(try sha.checkSpiral(k, i), got);
+                    }
+                }
+            }
+        }
+    }
+}
 
-    var result: [20]u8 = undefined;
-    dupe_hash.final(&result);
-    return result;
+test "tag kernels agree with trySpiral" {
+    const header = "object 26f67e5988b15877d2807511b262c870b2492548\ntype commit\ntag v1.0.0\n" ++
+        "tagger Will Leinweber <my@email.com> 1721827347 +0200\n";
+    inline for (.{ Sha1, Sha256 }) |Hash| {
+        const Sha = GitSha(Hash);
+        var sha = try Sha.initObject(.tag, header, "release\n", std.testing.allocator);
+        defer sha.deinit(std.testing.allocator);
+
+        var expected: Sha.Digest = undefined;
+        const body = header ++ "\n" ++ "release\n";
+        Hash.hash(std.fmt.comptimePrint("tag {d}\x00", .{body.len}) ++ body, &expected, .{});
+        try std.testing.expectEqual(expected, sha.startingSha);
+
+        inline for (std.meta.fields(Kernel)) |f| {
+            const k: Kernel = @enumFromInt(f.value);
+            if (k.supports(Sha.object_format)) {
+                var worker = try Sha.Worker.init(&sha, k, std.testing.allocator);
+                defer worker.deinit(std.testing.allocator);
+
+                var ns: [Kernel.max_lanes]i32 = undefined;
+                var out: [Kernel.max_lanes]Sha.Digest = undefined;
+                for (ns[0..k.lanes()], 0..) |*n, i| n.* = @intCast(i * 3 + 1);
+                try worker.run(ns[0..k.lanes()], out[0..k.lanes()]);
+                for (ns[0..k.lanes()], out[0..k.lanes()]) |n, got| {
+                    try std.testing.expectEqual(try sha.trySpiral(n), got);
+                }
+            }
+        }
+    }
 }
 
 inline fn mytoa(time: i64, dateBuf: *[10]u8) void {
@@ -188,8 +571,21 @@ fn spiral(ni: i32) [2]i32 {
     };
 }
 
+// 1, -1, 2, -2, ... for objects with a single timestamp
+fn zigzag(n: i32) i32 {
+    std.debug.assert(n > 0);
+    return if (n & 1 == 1) @divTrunc(n + 1, 2) else -@divTrunc(n, 2);
+}
+
 const expectEqual = std.testing.expectEqual;
 
+test "zigzag" {
+    try expectEqual(zigzag(1), 1);
+    try expectEqual(zigzag(2), -1);
+    try expectEqual(zigzag(3), 2);
+    try expectEqual(zigzag(4), -2);
+}
+
 test "spiral" {
     try expectEqual(spiral(1), .{ 1, 0 });
     try expectEqual(spiral(2), .{ 1, 1 });
@@ -211,18 +607,6 @@ test "spiral" {
     try expectEqual(spiral(16), .{ -2, 2 });
 }
 
-pub fn amend(self: *const Self, i: i32) !zlg.Oid {
-    const commit = try self.git.currentCommit();
-    const author = try commit.getAuthor().duplicate();
-    const committer = try commit.getCommitter().duplicate();
-    const offsets = spiral(i);
-
-    author.when.time += offsets[0];
-    committer.when.time += offsets[1];
-
-    return try commit.amend("HEAD", author, committer, null, null, null);
-}
-
 comptime {
     std.testing.refAllDecls(@This());
 }
@@ -0,0 +1,200 @@
+const std = @import("std");
+const Target = @import("target.zig");
+
+const Self = @This();
+
+// What a search is after: a hex prefix, or a predicate over the leading
+// nibbles ("digits", "zeros", "palindrome"). Every goal scores a digest by how
+// many leading nibbles qualify and matches once `need` of them do, so the
+// search can keep the best candidate so far whatever the goal is.
+//
+// The digest is spread into one nibble per byte of a vector and classified
+// with a single compare, the bools bitcast to a mask, and the qualifying
+// prefix is the mask's count of trailing ones.
+
+const N = 64; // nibbles in the longest (sha256) digest
+const Nibbles = @Vector(N, u8);
+
+pub const Kind = enum {
+    prefix, // the nibbles of a Target
+    digits, // no a-f
+    zeros,
+    palindrome, // the first `need` nibbles read the same backwards
+};
+
+kind: Kind,
+need: u8, // qualifying leading nibbles for a match
+want: Nibbles = @splat(0), // .prefix only
+
+pub fn fromTarget(target: Target) Self {
+    return .{
+        .kind = .prefix,
+        .need = @intCast(target.hexLen()),
+        .want = nibbles(target.buf[0..target.buf_len]),
+    };
+}
+
+/// `<kind>[:<nibbles>]` for a predicate, the whole digest when the count is
+/// left out, otherwise a hex prefix. `hex_len` is the repository's digest.
+pub fn parse(str: []const u8, hex_len: usize) !Self {
+    const name_end = std.mem.indexOfScalar(u8, str, ':') orelse str.len;
+    const kind = std.meta.stringToEnum(Kind, str[0..name_end]) orelse .prefix;
+    if (kind == .prefix) {
+        const target = try Target._init(str);
+        if (target.hexLen() > hex_len) return error.TooLong;
+        return fromTarget(target);
+    }
+
+    const need = if (name_end == str.len) hex_len else try std.fmt.parseUnsigned(u8, str[name_end + 1 ..], 10);
+    if (need == 0) return error.NoInput;
+    if (need > hex_len) return error.TooLong;
+    return .{ .kind = kind, .need = @intCast(need) };
+}
+
+test "parse" {
+    var g = try Self.parse("cafe1", 40);
+    try std.testing.expectEqual(.prefix, g.kind);
+    try std.testing.expectEqual(5, g.need);
+
+    g = try Self.parse("digits", 40);
+    try std.testing.expectEqual(.digits, g.kind);
+    try std.testing.expectEqual(40, g.need);
+
+    g = try Self.parse("zeros:8", 64);
+    try std.testing.expectEqual(.zeros, g.kind);
+    try std.testing.expectEqual(8, g.need);
+
+    try std.testing.expectError(error.TooLong, Self.parse("palindrome:41", 40));
+    try std.testing.expectError(error.TooLong, Self.parse("ab" ** 21, 40));
+    try std.testing.expectError(error.NoInput, Self.parse("digits:0", 40));
+    try std.testing.expectError(error.NotHexChr, Self.parse("great", 40));
+
+    try std.testing.expect(!(try Self.parse("cafe", 40)).keepsBest());
+    try std.testing.expect((try Self.parse("zeros", 40)).keepsBest());
+}
+
+/// Leading nibbles that qualify, capped at `need` where nibbles past it
+/// don't mean anything (prefix, palindrome).
+pub fn score(self: *const Self, digest: []const u8) u8 {
+    const nib = nibbles(digest);
+    const len: u8 = @intCast(digest.len * 2);
+    return switch (self.kind) {
+        .prefix => leading(nib == self.want, self.need),
+        .digits => leading(nib <= @as(Nibbles, @splat(9)), len),
+        .zeros => leading(nib == @as(Nibbles, @splat(0)), len),
+        .palindrome => palindrome(nib, self.need),
+    };
+}
+
+pub fn match(self: *const Self, digest: []const u8) bool {
+    return self.score(digest) >= self.need;
+}
+
+/// Whether a partial match is worth writing when a search stops short: the
+/// predicates keep their best candidate, a prefix matches or it doesn't.
+pub fn keepsBest(self: *const Self) bool {
+    return self.kind != .prefix;
+}
+
+/// Nibbles worth highlighting when printing a digest.
+pub fn highlight(self: *const Self, digest: []const u8) u8 {
+    return if (self.kind == .palindrome) self.need else self.score(digest);
+}
+
+/// The prefix as digest bytes, zeros past `need`. For .prefix goals.
+pub fn prefix(self: *const Self) [N / 2]u8 {
+    const want: [N]u8 = self.want;
+    var out: [N / 2]u8 = undefined;
+    for (&out, 0..) |*b, i| b.* = want[2 * i] << 4 | want[2 * i + 1];
+    return out;
+}
+
+fn nibbles(digest: []const u8) Nibbles {
+    var bytes = [_]u8{0} ** (N / 2);
+    @memcpy(bytes[0..digest.len], digest);
+    const v: @Vector(N / 2, u8) = bytes;
+    const hi = v >> @as(@Vector(N / 2, u3), @splat(4));
+    const lo = v & @as(@Vector(N / 2, u8), @splat(0xf));
+    return @shuffle(u8, hi, lo, interleave);
+}
+
+// hi[0], lo[0], hi[1], ... (~i picks lo[i])
+const interleave = blk: {
+    var mask: [N]i32 = undefined;
+    for (0..N / 2) |i| {
+        mask[2 * i] = i;
+        mask[2 * i + 1] = ~@as(i32, i);
+    }
+    break :blk mask;
+};
+
+fn bits(v: @Vector(N, bool)) u64 {
+    return @bitCast(v);
+}
+
+fn leading(v: @Vector(N, bool), limit: u8) u8 {
+    return @min(@ctz(~bits(v)), limit);
+}
+
+// Compared as four bit planes: plane b has bit i set when nibble i has bit b,
+// and mirroring the first `need` bits of a plane is a reverse and a shift.
+// Scores two per matching pair from the outside in, `need` once all match.
+fn palindrome(nib: Nibbles, need: u8) u8 {
+    const keep = if (need == N) ~@as(u64, 0) else (@as(u64, 1) << @intCast(need)) - 1;
+    var diff: u64 = 0;
+    inline for (0..4) |b| {
+        const plane = bits(nib & @as(Nibbles, @splat(1 << b)) != @as(Nibbles, @splat(0))) & keep;
+        diff |= plane ^ (@bitReverse(plane) >> @intCast(N - need));
+    }
+    const pairs: u8 = @min(@ctz(diff), need / 2);
+    return if (pairs == need / 2) need else pairs * 2;
+}
+
+test "score" {
+    const digest = [_]u8{ 0x00, 0x07, 0x19, 0x3a } ++ [_]u8{0xff} ** 16;
+
+    try std.testing.expectEqual(3, (try Self.parse("zeros", 40)).score(&digest));
+    try std.testing.expectEqual(7, (try Self.parse("digits", 40)).score(&digest));
+    try std.testing.expect((try Self.parse("digits:7", 40)).match(&digest));
+    try std.testing.expect(!(try Self.parse("digits:8", 40)).match(&digest));
+
+    // all digits runs into the zero padding past a sha1 digest
+    const digits = [_]u8{0x12} ** 20;
+    try std.testing.expectEqual(40, (try Self.parse("digits", 40)).score(&digits));
+
+    const pal = [_]u8{ 0x12, 0x32, 0x1f } ++ [_]u8{0} ** 17;
+    try std.testing.expectEqual(5, (try Self.parse("palindrome:5", 40)).score(&pal));
+    try std.testing.expectEqual(0, (try Self.parse("palindrome:6", 40)).score(&pal));
+    try std.testing.expectEqual(5, (try Self.parse("palindrome:5", 40)).highlight(&digest));
+    try std.testing.expectEqual(2, (try Self.parse("palindrome:40", 40)).score(&([_]u8{0x12} ++ [_]u8{0} ** 18 ++ [_]u8{0x31})));
+}
+
+test "prefix agrees with Target" {
+    const result: [20]u8 = .{ 0xef, 0x42, 0xba, 0xb1, 0x19, 0x1d, 0xa2, 0x72, 0xf1, 0x39, 0x35, 0xf7, 0x8c, 0x40, 0x1e, 0x3d, 0xe0, 0xc1, 0x1a, 0xfb };
+    for ([_][]const u8{ "e", "f", "ef42b", "ef42a", "ef42bab100", "ef42bab1191da", "ef02bab1191da" }) |str| {
+        const target = try Target._init(str);
+        const goal = fromTarget(target);
+        try std.testing.expectEqual(target.match(&result), goal.match(&result));
+    }
+    try std.testing.expectEqual(4, fromTarget(try Target._init("ef42a")).score(&result));
+    const prefix_bytes = fromTarget(try Target._init("ef42a")).prefix();
+    try std.testing.expectEqualSlices(u8, &.{ 0xef, 0x42, 0xa0, 0 }, prefix_bytes[0..4]);
+}
+
+pub fn format(
+    self: *const Self,
+    comptime fmt: []const u8,
+    options: std.fmt.FormatOptions,
+    writer: anytype,
+) !void {
+    _ = fmt;
+    _ = options;
+
+    if (self.kind != .prefix) return writer.print("{s}:{d}", .{ @tagName(self.kind), self.need });
+    const want: [N]u8 = self.want;
+    for (want[0..self.need]) |n| try writer.print("{x}", .{n});
+}
+
+comptime {
+    std.testing.refAllDecls(Self);
+}
@@ -0,0 +1,97 @@
+const std = @import("std");
+const builtin = @import("builtin");
+const ObjectFormat = @import("objectFormat.zig").ObjectFormat;
+
+const is_x86_64 = builtin.cpu.arch == .x86_64;
+const has_sha_ni = @import("sha256ni.zig").available;
+const has_avx2 = is_x86_64 and std.Target.x86.featureSetHas(builtin.cpu.features, .avx2);
+const is_aarch64 = builtin.cpu.arch == .aarch64;
+const has_sha1_ce = @import("sha1ce.zig").available;
+const has_neon = is_aarch64 and std.Target.aarch64.featureSetHas(builtin.cpu.features, .neon);
+
+/// The hash implementations the search loop can dispatch to. All of them hash
+/// the same candidates, they differ in how many they take per call and which
+/// instructions do the compression.
+pub const Kernel = enum {
+    /// `GitSha.trySpiral`, the std.crypto hasher fed piece by piece
+    reference,
+    /// the padded tail patched in place and run through std.crypto
+    scalar,
+    /// the padded tail through x86 sha256rnds2/sha256msg1/sha256msg2, see sha256ni.zig
+    sha_ni,
+    /// eight SHA-256 candidates at once in 256-bit vectors, see sha256x8.zig
+    avx2_x8,
+    /// the padded tail through ARMv8 sha1c/sha1p/sha1m, see sha1ce.zig
+    sha1_ce,
+    /// four SHA-1 candidates at once in 128-bit NEON vectors, see sha1x4.zig
+    neon_x4,
+
+    pub const max_lanes = 8;
+
+    pub fn lanes(self: Kernel) usize {
+        return switch (self) {
+            .reference, .scalar, .sha_ni, .sha1_ce => 1,
+            .neon_x4 => 4,
+            .avx2_x8 => 8,
+        };
+    }
+
+    // whether this build and object format can run the kernel at all
+    pub fn supports(self: Kernel, object_format: ObjectFormat) bool {
+        return switch (self) {
+            .reference, .scalar => true,
+            .sha_ni => has_sha_ni and object_format == .sha256,
+            .avx2_x8 => has_avx2 and object_format == .sha256,
+            .sha1_ce => has_sha1_ce and object_format == .sha1,
+            .neon_x4 => has_neon and object_format == .sha1,
+        };
+    }
+
+    pub fn best(object_format: ObjectFormat) Kernel {
+        inline for (.{ Kernel.sha_ni, Kernel.sha1_ce, Kernel.avx2_x8, Kernel.neon_x4 }) |k| {
+            if (k.supports(object_format)) return k;
+        }
+        return .scalar;
+    }
+};
+
+// SHA-1 and SHA-256 pad the same way: 0x80, zeros, then the big endian bit
+// length of the whole message (`total_len` bytes, including any midstate
+// prefix) in the last 8 bytes of a 64-byte block.
+pub fn paddedLength(len: usize) usize {
+    return (len + 9 + 63) / 64 * 64;
+}
+
+pub fn pad(buf: []u8, len: usize, total_len: u64) void {
+    std.debug.assert(buf.len == paddedLength(len));
+    buf[len] = 0x80;
+    @memset(buf[len + 1 .. buf.len - 8], 0);
+    std.mem.writeInt(u64, buf[buf.len - 8 ..][0..8], total_len * 8, .big);
+}
+
+test "pad" {
+    var buf: [64]u8 = undefined;
+    @memcpy(buf[0..3], "abc");
+    pad(&buf, 3, 3);
+    try std.testing.expectEqual(0x80, buf[3]);
+    try std.testing.expectEqual(24, buf[63]);
+    try std.testing.expectEqual(64, paddedLength(55));
+    try std.testing.expectEqual(128, paddedLength(56));
+}
+
+test "best" {
+    try std.testing.expect(Kernel.best(.sha1).supports(.sha1));
+    if (!is_aarch64) try std.testing.expectEqual(Kernel.scalar, Kernel.best(.sha1));
+    try std.testing.expect(Kernel.best(.sha256).supports(.sha256));
+    try std.testing.expect(!Kernel.avx2_x8.supports(.sha1));
+}
+
+test "lanes" {
+    inline for (std.meta.fields(Kernel)) |f| {
+        try std.testing.expect(@as(Kernel, @enumFromInt(f.value)).lanes() <= Kernel.max_lanes);
+    }
+}
+
+comptime {
+    std.testing.refAllDecls(@This());
+}
@@ -0,0 +1,53 @@
+const std = @import("std");
+
+/// The hash a repository names its objects with (`extensions.objectFormat`).
+pub const ObjectFormat = enum {
+    sha1,
+    sha256,
+
+    pub const max_digest_length = 32;
+
+    pub fn Hash(comptime self: ObjectFormat) type {
+        return switch (self) {
+            .sha1 => std.crypto.hash.Sha1,
+            .sha256 => std.crypto.hash.sha2.Sha256,
+        };
+    }
+
+    pub fn digestLength(self: ObjectFormat) usize {
+        return switch (self) {
+            .sha1 => 20,
+            .sha256 => 32,
+        };
+    }
+
+    pub fn hexLength(self: ObjectFormat) usize {
+        return self.digestLength() * 2;
+    }
+
+    // what `git rev-parse --show-object-format` prints, empty means the default
+    pub fn parse(str: []const u8) !ObjectFormat {
+        const name = std.mem.trim(u8, str, " \t\r\n");
+        if (name.len == 0 or std.ascii.eqlIgnoreCase(name, "sha1")) return .sha1;
+        if (std.ascii.eqlIgnoreCase(name, "sha256")) return .sha256;
+        return error.UnknownObjectFormat;
+    }
+};
+
+test "parse" {
+    try std.testing.expectEqual(ObjectFormat.sha1, try ObjectFormat.parse("sha1\n"));
+    try std.testing.expectEqual(ObjectFormat.sha1, try ObjectFormat.parse(""));
+    try std.testing.expectEqual(ObjectFormat.sha256, try ObjectFormat.parse("sha256\n"));
+    try std.testing.expectError(error.UnknownObjectFormat, ObjectFormat.parse("md5"));
+}
+
+test "lengths" {
+    inline for (.{ ObjectFormat.sha1, ObjectFormat.sha256 }) |f| {
+        try std.testing.expectEqual(f.Hash().digest_length, f.digestLength());
+    }
+    try std.testing.expectEqual(64, ObjectFormat.sha256.hexLength());
+}
+
+comptime {
+    std.testing.refAllDecls(@This());
+}
@@ -0,0 +1,203 @@
+const Self = @This();
+const std = @import("std");
+
+// Every object id already in the repository, so a hit whose prefix some other
+// object shares (`git show <prefix>` would be ambiguous) can be turned down.
+// Pack .idx files are mapped as is: their ids are sorted, and the fanout table
+// (how many ids start with a byte <= b) narrows a lookup to one first byte
+// before a binary search. Loose objects are listed once into a sorted array.
+// Alternates aren't followed.
+
+const max_hash = 32;
+
+const Ids = struct {
+    bytes: []const u8,
+    stride: usize, // an id every `stride` bytes
+    fanout: ?[]const u8 = null, // 256 big endian counts, packs only
+
+    fn id(self: Ids, i: usize, hash_len: usize) []const u8 {
+        return self.bytes[i * self.stride ..][0..hash_len];
+    }
+
+    fn count(self: Ids) usize {
+        return (self.bytes.len + self.stride - 1) / self.stride;
+    }
+
+    fn below(self: Ids, byte: usize) usize {
+        if (byte == 0) return 0;
+        return std.mem.readInt(u32, self.fanout.?[(byte - 1) * 4 ..][0..4], .big);
+    }
+};
+
+hash_len: usize,
+packs: std.ArrayListUnmanaged(Ids) = .{},
+maps: std.ArrayListUnmanaged([]align(std.mem.page_size) const u8) = .{},
+loose: std.ArrayListUnmanaged([max_hash]u8) = .{},
+allocator: std.mem.Allocator,
+
+/// Maps `<objects>/pack/*.idx` and lists the loose objects.
+pub fn init(objects_dir: []const u8, hash_len: usize, allocator: std.mem.Allocator) !Self {
+    var self = Self{ .hash_len = hash_len, .allocator = allocator };
+    errdefer self.deinit();
+
+    var objects = try std.fs.cwd().openDir(objects_dir, .{ .iterate = true });
+    defer objects.close();
+
+    if (objects.openDir("pack", .{ .iterate = true })) |pack_dir| {
+        var dir = pack_dir;
+        defer dir.close();
+        var it = dir.iterate();
+        while (try it.next()) |entry| {
+            if (entry.kind != .file or !std.mem.endsWith(u8, entry.name, ".idx")) continue;
+            try self.mapIdx(dir, entry.name);
+        }
+    } else |err| switch (err) {
+        error.FileNotFound => {},
+        else => return err,
+    }
+
+    var it = objects.iterate();
+    while (try it.next()) |entry| {
+        var first: [1]u8 = undefined;
+        if (entry.kind != .directory or entry.name.len != 2) continue;
+        _ = std.fmt.hexToBytes(&first, entry.name) catch continue;
+
+        var dir = try objects.openDir(entry.name, .{ .iterate = true });
+        defer dir.close();
+        var files = dir.iterate();
+        while (try files.next()) |file| {
+            if (file.name.len != hash_len * 2 - 2) continue;
+            var id = [_]u8{0} ** max_hash;
+            id[0] = first[0];
+            _ = std.fmt.hexToBytes(id[1..hash_len], file.name) catch continue;
+            try self.loose.append(allocator, id);
+        }
+    }
+    std.mem.sort([max_hash]u8, self.loose.items, {}, lessThan);
+
+    return self;
+}
+
+pub fn deinit(self: *Self) void {
+    for (self.maps.items) |map| std.posix.munmap(map);
+    self.maps.deinit(self.allocator);
+    self.packs.deinit(self.allocator);
+    self.loose.deinit(self.allocator);
+}
+
+fn lessThan(_: void, a: [max_hash]u8, b: [max_hash]u8) bool {
+    return std.mem.order(u8, &a, &b) == .lt;
+}
+
+// v2 starts with a magic and version before the fanout and keeps ids in their
+// own table, v1 has the fanout first and an offset before each id
+fn mapIdx(self: *Self, dir: std.fs.Dir, name: []const u8) !void {
+    const file = try dir.openFile(name, .{});
+    defer file.close();
+    const size = (try file.stat()).size;
+    if (size < 8 + 256 * 4) return error.BadPackIndex;
+
+    const map = try std.posix.mmap(null, size, std.posix.PROT.READ, .{ .TYPE = .PRIVATE }, file.handle, 0);
+    errdefer std.posix.munmap(map);
+
+    const v2 = std.mem.eql(u8, map[0..8], "\xfftOc\x00\x00\x00\x02");
+    const fanout_at: usize = if (v2) 8 else 0;
+    const fanout = map[fanout_at..][0 .. 256 * 4];
+    const n: usize = std.mem.readInt(u32, fanout[255 * 4 ..][0..4], .big);
+    const ids: Ids = if (v2)
+        .{ .bytes = map[8 + 256 * 4 ..], .stride = self.hash_len, .fanout = fanout }
+    else
+        .{ .bytes = map[256 * 4 + 4 ..], .stride = 4 + self.hash_len, .fanout = fanout };
+    if (ids.bytes.len < n * ids.stride) return error.BadPackIndex;
+
+    try self.maps.append(self.allocator, map);
+    try self.packs.append(self.allocator, .{
+        .bytes = ids.bytes[0 .. n * ids.stride],
+        .stride = ids.stride,
+        .fanout = fanout,
+    });
+}
+
+pub fn count(self: *const Self) usize {
+    var n = self.loose.items.len;
+    for (self.packs.items) |pack| n += pack.count();
+    return n;
+}
+
+/// Whether an object already here starts with the same `nibbles` nibbles as
+/// `id`. A binary search per pack, safe to call from every search thread.
+pub fn ambiguous(self: *const Self, id: []const u8, nibbles: usize) bool {
+    // one nibble leaves sixteen possible first bytes
+    const lo_byte: usize = if (nibbles == 1) id[0] & 0xf0 else id[0];
+    const hi_byte: usize = if (nibbles == 1) id[0] | 0x0f else id[0];
+
+    for (self.packs.items) |pack| {
+        if (self.find(pack, pack.below(lo_byte), pack.below(hi_byte + 1), id, nibbles)) return true;
+    }
+    const loose = Ids{ .bytes = std.mem.sliceAsBytes(self.loose.items), .stride = max_hash };
+    return self.find(loose, 0, self.loose.items.len, id, nibbles);
+}
+
+// lower bound of `id`'s prefix in [lo, hi), then whether it's there
+fn find(self: *const Self, ids: Ids, lo_: usize, hi_: usize, id: []const u8, nibbles: usize) bool {
+    var lo = lo_;
+    var hi = hi_;
+    while (lo < hi) {
+        const mid = lo + (hi - lo) / 2;
+        if (order(ids.id(mid, self.hash_len), id, nibbles) == .lt) lo = mid + 1 else hi = mid;
+    }
+    return lo < hi_ and order(ids.id(lo, self.hash_len), id, nibbles) == .eq;
+}
+
+fn order(a: []const u8, b: []const u8, nibbles: usize) std.math.Order {
+    const whole = nibbles / 2;
+    const o = std.mem.order(u8, a[0..whole], b[0..whole]);
+    if (o != .eq or nibbles % 2 == 0) return o;
+    return std.math.order(a[whole] >> 4, b[whole] >> 4);
+}
+
+test "ambiguous" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    // a v2 index with three ids, and one loose object
+    var idx = std.ArrayList(u8).init(std.testing.allocator);
+    defer idx.deinit();
+    try idx.appendSlice("\xfftOc\x00\x00\x00\x02");
+    const ids = [_][20]u8{
+        [_]u8{0x12} ++ [_]u8{0x34} ** 19,
+        [_]u8{0xca} ++ [_]u8{0xfe} ** 19,
+        [_]u8{0xca} ++ [_]u8{0xff} ** 19,
+    };
+    for (0..256) |b| {
+        var n: u32 = 0;
+        for (ids) |id| n += @intFromBool(id[0] <= b);
+        try idx.writer().writeInt(u32, n, .big);
+    }
+    for (ids) |id| try idx.appendSlice(&id);
+    try idx.appendNTimes(0, 3 * 4 + 2 * 20); // crcs, offsets, checksums
+
+    try tmp.dir.makePath("objects/pack");
+    try tmp.dir.writeFile(.{ .sub_path = "objects/pack/pack-1.idx", .data = idx.items });
+    try tmp.dir.makePath("objects/ab");
+    try tmp.dir.writeFile(.{ .sub_path = "objects/ab/" ++ "cd" ** 19, .data = "" });
+
+    const path = try tmp.dir.realpathAlloc(std.testing.allocator, "objects");
+    defer std.testing.allocator.free(path);
+    var index = try Self.init(path, 20, std.testing.allocator);
+    defer index.deinit();
+    try std.testing.expectEqual(4, index.count());
+
+    const hit = [_]u8{ 0xca, 0xfe, 0x00 } ++ [_]u8{0} ** 17;
+    try std.testing.expect(index.ambiguous(&hit, 4));
+    try std.testing.expect(index.ambiguous(&hit, 3));
+    try std.testing.expect(!index.ambiguous(&hit, 5));
+    try std.testing.expect(index.ambiguous(&([_]u8{0x1f} ++ [_]u8{0} ** 19), 1));
+    try std.testing.expect(!index.ambiguous(&([_]u8{0x2f} ++ [_]u8{0} ** 19), 1));
+    try std.testing.expect(index.ambiguous(&([_]u8{ 0xab, 0xcd, 0xc0 } ++ [_]u8{0} ** 17), 5));
+    try std.testing.expect(!index.ambiguous(&([_]u8{ 0xab, 0xcd, 0xc0 } ++ [_]u8{0} ** 17), 6));
+}
+
+comptime {
+    std.testing.refAllDecls(Self);
+}
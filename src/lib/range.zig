@@ -0,0 +1,516 @@
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const Git = @import("git.zig");
+const GitAlloc = @import("gitAlloc.zig");
+const Goal = @import("goal.zig");
+const kernel = @import("kernel.zig");
+const Kernel = kernel.Kernel;
+const parseHeader = @import("gitSha.zig").parseHeader;
+const ObjectIndex = @import("objectIndex.zig");
+const CommitGraph = @import("commitGraph.zig");
+const search = @import("search.zig");
+const Search = search.Search;
+
+// `git-vain range <a>..<b>`: every commit in the range gets the target. A
+// child's hash covers its parents' ids, so it can only be searched once they
+// are rewritten, but merged topic branches are independent chains. The range
+// is kept as a DAG and every commit whose parents are done is searched at the
+// same time, splitting the threads by how much work is left behind each one.
+// Hits are checked against the objects there already like a single search's,
+// but a prefix goal gives every rewritten commit the same prefix, so those
+// only differ from each other past it.
+//
+// libgit2 allocates from a GitAlloc arena, which only gives memory back when
+// it's reset with libgit2 shut down. Every written commit ends a job, so
+// nothing libgit2 hands out may live past the next finish.
+
+pub fn Range(comptime Sha: type) type {
+    return struct {
+        const Self = @This();
+
+        // Only what the DAG and the commit-graph layer need. The object itself
+        // is read again once the commit is ready.
+        const Node = struct {
+            oid: [:0]const u8,
+            tree: []const u8, // id bytes
+            parents: []const Edge,
+            children: std.ArrayListUnmanaged(usize) = .{},
+            // in-range parents not rewritten yet
+            pending: usize = 0,
+            // tail blocks per candidate along the longest chain from here to a
+            // tip. Every commit needs the same number of candidates on
+            // average, so this is the expected cost of what's left.
+            height: u64 = 0,
+            new_oid: ?[]const u8 = null,
+            new_time: i64 = 0, // committer
+        };
+
+        // One per commit being searched, reused once it's written so a long
+        // range doesn't allocate per commit.
+        const Running = struct {
+            node: usize,
+            // the object's bytes, tail, worker lanes and the written body,
+            // reset by finish
+            job: search.JobArena,
+            allocator: Allocator = undefined,
+            sha: Sha,
+            search: Search(Sha),
+            threads: std.ArrayListUnmanaged(std.Thread) = .{},
+        };
+
+        git: *Git,
+        git_alloc: ?*GitAlloc,
+        goal: Goal,
+        known: ?*const ObjectIndex,
+        verify_every: u32,
+        kernel: Kernel,
+        nodes: []Node,
+        index: std.StringHashMapUnmanaged(usize) = .{},
+        ready: std.ArrayListUnmanaged(usize) = .{},
+        running: std.ArrayListUnmanaged(*Running) = .{},
+        spare: std.ArrayListUnmanaged(*Running) = .{},
+        // dispatch's scratch
+        starting: std.ArrayListUnmanaged(usize) = .{},
+        heights: std.ArrayListUnmanaged(u64) = .{},
+        shares: std.ArrayListUnmanaged(usize) = .{},
+        free_threads: usize,
+        left: usize,
+        // posted by whichever search finds its match
+        found: std.Thread.Semaphore = .{},
+        // kernels caught miscomputing, shared by every commit's search
+        demoted: std.atomic.Value(u32) = std.atomic.Value(u32).init(0),
+        // the first error a search thread returned, posted like a match
+        failed: ?anyerror = null,
+        failed_lock: std.Thread.Mutex = .{},
+        // stops every search when the run is failing
+        cancel: std.atomic.Value(bool) = std.atomic.Value(bool).init(false),
+        arena: Allocator, // the DAG, lives for the whole run, main thread only
+        gpa: Allocator, // backs the JobArenas and the objects read during load
+
+        /// Rewrites the range and moves HEAD when its commit was in it.
+        pub fn run(git: *Git, git_alloc: ?*GitAlloc, range: [:0]const u8, goal: Goal, known: ?*const ObjectIndex, verify_every: u32, threads: usize, gpa: Allocator) !void {
+            var arena_state = std.heap.ArenaAllocator.init(gpa);
+            defer arena_state.deinit();
+
+            var self = Self{
+                .git = git,
+                .git_alloc = git_alloc,
+                .goal = goal,
+                .known = known,
+                .verify_every = verify_every,
+                .kernel = Kernel.best(Sha.object_format),
+                .nodes = &.{},
+                .free_threads = threads,
+                .left = 0,
+                .arena = arena_state.allocator(),
+                .gpa = gpa,
+            };
+            defer for (self.spare.items) |r| r.job.deinit();
+            try self.load(range);
+            std.debug.print("{d} commits, critical path {d} blocks\n", .{ self.nodes.len, self.criticalPath() });
+
+            errdefer self.stopAll();
+            while (self.left > 0) {
+                try self.dispatch();
+                if (self.running.items.len == 0) {
+                    // everything ready already matched, unless nothing could start
+                    if (self.ready.items.len == 0 or self.free_threads == 0) return error.RangeStalled;
+                    continue;
+                }
+                self.found.wait();
+                if (self.takeFailed()) |err| return err;
+
+                var i: usize = 0;
+                while (i < self.running.items.len) {
+                    const r = self.running.items[i];
+                    if (!r.search.flag.found) {
+                        i += 1;
+                        continue;
+                    }
+                    _ = self.running.swapRemove(i);
+                    try self.finish(r, r.search.flag.value);
+                }
+            }
+
+            self.writeGraph() catch |err| std.debug.print("commit-graph not extended: {!}\n", .{err});
+
+            const head = try git.revParse("HEAD", self.arena);
+            if (self.index.get(head)) |i| {
+                try git.updateRef("HEAD", self.nodes[i].new_oid.?, head, self.arena);
+            } else {
+                std.debug.print("HEAD isn't in the range, no refs moved\n", .{});
+            }
+        }
+
+        fn load(self: *Self, range: [:0]const u8) !void {
+            const oids = try self.git.rangeCommits(range, self.arena);
+            try self.endGitJob("walking {s}", .{range});
+            self.nodes = try self.arena.alloc(Node, oids.len);
+            self.left = oids.len;
+            for (oids, 0..) |oid, i| try self.index.put(self.arena, oid, i);
+
+            // only parents inside the range get rewritten, the rest stay as is.
+            // Every object is read once here and let go, `height` holds its
+            // own tail blocks until the pass below adds the longest child
+            for (oids, self.nodes, 0..) |oid, *node, i| {
+                // a job per batch, so what libgit2 keeps cached goes back too
+                if (i > 0 and i % load_batch == 0) try self.endGitJob("loading {d}/{d}", .{ i, oids.len });
+                const raw = try self.git.commitRaw(oid, self.gpa);
+                defer raw.deinit(self.gpa);
+
+                var edges = std.ArrayListUnmanaged(Edge){};
+                var pending: usize = 0;
+                var it = parents(raw.header);
+                while (it.next()) |p| {
+                    if (self.index.get(p.oid)) |parent| {
+                        try self.nodes[parent].children.append(self.arena, i);
+                        try edges.append(self.arena, .{ .node = parent });
+                        pending += 1;
+                    } else {
+                        try edges.append(self.arena, .{ .kept = try self.hexBytes(p.oid) });
+                    }
+                }
+                node.* = .{
+                    .oid = oid,
+                    .tree = try self.hexBytes(treeOf(raw.header)),
+                    .parents = edges.items,
+                    .pending = pending,
+                    .height = try tailBlocks(raw),
+                };
+                if (pending == 0) try self.ready.append(self.arena, i);
+            }
+            try self.endGitJob("loading {d}/{d}", .{ oids.len, oids.len });
+
+            // rev-list order puts children after their parents
+            var i = self.nodes.len;
+            while (i > 0) {
+                i -= 1;
+                var longest: u64 = 0;
+                for (self.nodes[i].children.items) |c| longest = @max(longest, self.nodes[c].height);
+                self.nodes[i].height += longest;
+            }
+        }
+
+        fn criticalPath(self: *const Self) u64 {
+            var longest: u64 = 0;
+            for (self.ready.items) |i| longest = @max(longest, self.nodes[i].height);
+            return longest;
+        }
+
+        fn byHeight(self: *Self, a: usize, b: usize) bool {
+            return self.nodes[a].height < self.nodes[b].height;
+        }
+
+        fn runningByHeight(self: *Self, a: *Running, b: *Running) bool {
+            return self.nodes[a.node].height > self.nodes[b.node].height;
+        }
+
+        // Starts ready commits on the free threads, each getting a share in
+        // proportion to its height. Threads left over with nothing ready join
+        // the running searches with the most work behind them.
+        fn dispatch(self: *Self) !void {
+            std.mem.sort(usize, self.ready.items, self, byHeight);
+
+            while (self.ready.items.len > 0 and self.free_threads > 0) {
+                try self.heights.resize(self.arena, self.ready.items.len);
+                for (self.heights.items, self.ready.items) |*h, i| h.* = self.nodes[i].height;
+                try self.shares.resize(self.arena, self.ready.items.len);
+                const shares = threadShares(self.heights.items, self.free_threads, self.shares.items);
+
+                // the tallest ones, taken off `ready` first since a commit that
+                // already matches finishes in start() and readies its children
+                self.starting.clearRetainingCapacity();
+                try self.starting.appendSlice(self.arena, self.ready.items[self.ready.items.len - shares.len ..]);
+                self.ready.shrinkRetainingCapacity(self.ready.items.len - shares.len);
+
+                var k = shares.len;
+                while (k > 0) {
+                    k -= 1;
+                    try self.start(self.starting.items[k], shares[k]);
+                }
+                std.mem.sort(usize, self.ready.items, self, byHeight);
+            }
+
+            if (self.free_threads == 0 or self.running.items.len == 0) return;
+            std.mem.sort(*Running, self.running.items, self, runningByHeight);
+            var r: usize = 0;
+            while (self.free_threads > 0) : (r = (r + 1) % self.running.items.len) {
+                try self.spawn(self.running.items[r]);
+            }
+        }
+
+        fn start(self: *Self, i: usize, threads: usize) !void {
+            try self.spare.ensureUnusedCapacity(self.arena, 1);
+            const r = self.spare.popOrNull() orelse blk: {
+                const fresh = try self.arena.create(Running);
+                fresh.* = .{ .node = i, .job = search.JobArena.init(self.gpa), .sha = undefined, .search = undefined };
+                fresh.allocator = fresh.job.allocator();
+                break :blk fresh;
+            };
+            self.prepare(r, i) catch |err| {
+                r.job.reset();
+                self.spare.appendAssumeCapacity(r);
+                return err;
+            };
+
+            // possible when it already matched and none of its parents changed
+            if (self.goal.match(&r.sha.startingSha)) return self.finish(r, 0);
+
+            try self.running.append(self.arena, r);
+            for (0..threads) |_| try self.spawn(r);
+        }
+
+        // reads commit `i` again and sets up its search in `r`
+        fn prepare(self: *Self, r: *Running, i: usize) !void {
+            r.node = i;
+            r.threads.clearRetainingCapacity();
+            const raw = try self.git.commitRaw(self.nodes[i].oid, r.allocator);
+            defer raw.deinit(r.allocator);
+
+            // copied out, libgit2's copy goes with the current job; the header
+            // gets the new parents
+            const header = try r.allocator.dupe(u8, raw.header);
+            const message = try r.allocator.dupe(u8, raw.message);
+            var it = parents(raw.header);
+            while (it.next()) |p| {
+                const parent = self.index.get(p.oid) orelse continue;
+                @memcpy(header[p.at..][0..p.oid.len], self.nodes[parent].new_oid.?);
+            }
+
+            r.sha = try Sha.initRaw(header, message, r.allocator);
+            r.sha.git = self.git;
+            r.search = .{ .sha = &r.sha, .kernel = self.kernel, .goal = self.goal, .known = self.known, .verify_every = self.verify_every, .demoted = &self.demoted, .on_found = &self.found, .cancel = &self.cancel };
+        }
+
+        fn spawn(self: *Self, r: *Running) !void {
+            try r.threads.ensureUnusedCapacity(self.arena, 1);
+            r.threads.appendAssumeCapacity(try std.Thread.spawn(.{}, searchThread, .{ self, r }));
+            self.free_threads -= 1;
+        }
+
+        // a thread that fails wakes the run loop like a match would, or it
+        // would wait on a search nobody is running
+        fn searchThread(self: *Self, r: *Running) void {
+            r.search.search(r.allocator) catch |err| {
+                self.failed_lock.lock();
+                defer self.failed_lock.unlock();
+                if (self.failed == null) self.failed = err;
+                self.found.post();
+            };
+        }
+
+        fn takeFailed(self: *Self) ?anyerror {
+            self.failed_lock.lock();
+            defer self.failed_lock.unlock();
+            return self.failed;
+        }
+
+        // on the way out with an error: every search gives up at its next
+        // chunk, and nothing may outlive `self` or its job
+        fn stopAll(self: *Self) void {
+            self.cancel.store(true, .monotonic);
+            for (self.running.items) |r| {
+                for (r.threads.items) |t| t.join();
+                r.job.deinit();
+            }
+        }
+
+        fn finish(self: *Self, r: *Running, n: i32) !void {
+            for (r.threads.items) |t| t.join();
+            self.free_threads += r.threads.items.len;
+            defer {
+                r.job.reset();
+                self.spare.append(self.arena, r) catch r.job.deinit();
+            }
+
+            const node = &self.nodes[r.node];
+            if (r.search.gave_up and !self.goal.keepsBest()) {
+                std.debug.print("{s}: spiral used up without a match\n", .{node.oid});
+                return error.NoMatch;
+            }
+            // rendered in the job, only the id outlives it
+            node.new_oid = try self.arena.dupe(u8, try r.sha.write(n, r.allocator));
+            node.new_time = r.sha.committerTime(n);
+            if (r.search.gave_up) std.debug.print("{s}: spiral used up, writing the best candidate\n", .{node.oid});
+            std.debug.print("{s} -> {s}\n", .{ node.oid, node.new_oid.? });
+            try self.endGitJob("{s}", .{node.oid});
+
+            self.left -= 1;
+            for (node.children.items) |c| {
+                self.nodes[c].pending -= 1;
+                if (self.nodes[c].pending == 0) try self.ready.append(self.arena, c);
+            }
+        }
+
+        // Shuts libgit2 down so none of its memory is live, drops everything it
+        // allocated and opens the repository again. Through the git cli
+        // there's nothing to drop.
+        fn endGitJob(self: *Self, comptime job: []const u8, args: anytype) !void {
+            const ga = self.git_alloc orelse return;
+            if (self.git.repo == null) return;
+            self.git.deinit();
+            ga.reset().log(job, args);
+            self.git.* = try Git.init();
+        }
+
+        // The rewritten commits as a new commit-graph layer, so `git log
+        // --graph` and ahead/behind counts don't parse them until the next gc.
+        fn writeGraph(self: *Self) !void {
+            const dir = try self.git.objectsDir(self.arena);
+            // held from before the load, nothing may change the graph in between
+            var lock = try CommitGraph.Lock.take(dir);
+            defer lock.release();
+            var graph = try CommitGraph.load(dir, @sizeOf(Sha.Digest), self.arena) orelse {
+                std.debug.print("no commit-graph to extend\n", .{});
+                return;
+            };
+            defer graph.deinit();
+
+            var commits = std.ArrayListUnmanaged(CommitGraph.NewCommit){};
+            for (self.nodes) |node| {
+                const oid = try self.hexBytes(node.new_oid.?);
+                if (graph.find(oid) != null) continue; // matched already and kept as is
+
+                const ps = try self.arena.alloc([]const u8, node.parents.len);
+                for (ps, node.parents) |*p, e| p.* = switch (e) {
+                    .node => |i| try self.hexBytes(self.nodes[i].new_oid.?),
+                    .kept => |id| id,
+                };
+                try commits.append(self.arena, .{
+                    .oid = oid,
+                    .tree = node.tree,
+                    .parents = ps,
+                    .time = node.new_time,
+                });
+            }
+            if (commits.items.len == 0) return;
+            try graph.writeLayer(Sha.object_format.Hash(), &lock, dir, commits.items, self.arena);
+        }
+
+        fn hexBytes(self: *Self, hex: []const u8) ![]u8 {
+            return std.fmt.hexToBytes(try self.arena.alloc(u8, hex.len / 2), hex);
+        }
+    };
+}
+
+// Threads for each of the tallest ready commits, `heights` sorted ascending
+// like `ready`. Only the last min(heights.len, free) get any, in `out` from
+// the front: at least one each, the rest in proportion to height, and the
+// shortest of them takes what rounding leaves over.
+fn threadShares(heights: []const u64, free: usize, out: []usize) []const usize {
+    const count = @min(heights.len, free);
+    const tallest = heights[heights.len - count ..];
+    var total: u64 = 0;
+    for (tallest) |h| total += h;
+
+    var given: usize = 0;
+    var k = count;
+    while (k > 0) {
+        k -= 1;
+        // each one still to go needs a thread
+        out[k] = if (k == 0) free - given else @max(1, @min(
+            free - given - k,
+            free * tallest[k] / @max(total, 1),
+        ));
+        given += out[k];
+    }
+    return out[0..count];
+}
+
+test "threadShares" {
+    var out: [8]usize = undefined;
+    try std.testing.expectEqualSlices(usize, &.{8}, threadShares(&.{5}, 8, &out));
+    try std.testing.expectEqualSlices(usize, &.{ 1, 3 }, threadShares(&.{ 1, 100 }, 4, &out));
+    try std.testing.expectEqualSlices(usize, &.{ 2, 1, 1 }, threadShares(&.{ 10, 10, 10 }, 4, &out));
+    try std.testing.expectEqualSlices(usize, &.{ 2, 3, 3 }, threadShares(&.{ 2, 3, 3 }, 8, &out));
+    // nothing left behind any of them
+    try std.testing.expectEqualSlices(usize, &.{ 3, 1 }, threadShares(&.{ 0, 0 }, 4, &out));
+    // more ready than free threads: only the tallest three start, one each
+    try std.testing.expectEqualSlices(usize, &.{ 1, 1, 1 }, threadShares(&.{ 1, 2, 3, 5, 8 }, 3, &out));
+    try std.testing.expectEqual(0, threadShares(&.{}, 4, &out).len);
+}
+
+// commits read per libgit2 job while loading
+const load_batch = 4096;
+
+// a commit's parent as the commit-graph layer needs it
+const Edge = union(enum) {
+    node: usize, // in the range, rewritten
+    kept: []const u8, // outside it, id bytes
+};
+
+// the first header line is always "tree <oid>"
+fn treeOf(header: []const u8) []const u8 {
+    const end = std.mem.indexOfScalar(u8, header, '\n') orelse header.len;
+    return header["tree ".len..end];
+}
+
+const Parent = struct {
+    oid: []const u8,
+    at: usize, // offset of `oid` in the header
+};
+
+// top level "parent <oid>" lines
+pub fn parents(header: []const u8) ParentIterator {
+    return .{ .lines = std.mem.splitScalar(u8, header, '\n') };
+}
+
+const ParentIterator = struct {
+    lines: std.mem.SplitIterator(u8, .scalar),
+    at: usize = 0,
+
+    fn next(self: *ParentIterator) ?Parent {
+        while (self.lines.next()) |line| {
+            const line_start = self.at;
+            self.at += line.len + 1;
+            if (std.mem.startsWith(u8, line, "parent ")) return .{ .oid = line[7..], .at = line_start + 7 };
+        }
+        return null;
+    }
+};
+
+// blocks hashed per candidate, everything before the author timestamp is midstate
+fn tailBlocks(raw: Git.RawObject) !u64 {
+    const hinfo = try parseHeader(raw.header);
+    const len = raw.header.len + 1 + raw.message.len;
+    var buf: [32]u8 = undefined;
+    const prefix_len = (std.fmt.bufPrint(&buf, "commit {d}\x00", .{len}) catch unreachable).len;
+    const midstate_len = (prefix_len + hinfo.author_time_start) / 64 * 64;
+    return kernel.paddedLength(prefix_len + len - midstate_len) / 64;
+}
+
+test "parents" {
+    const header =
+        \\tree e9054e9ccfee355e80c40ba84abb8f438f9e688b
+        \\parent 26f67e5988b15877d2807511b262c870b2492548
+        \\parent 37f67e5988b15877d2807511b262c870b2492548
+        \\author Will Leinweber <my@email.com> 1721827347 +0200
+        \\
+    ;
+    var it = parents(header);
+    const a = it.next().?;
+    try std.testing.expectEqualStrings("26f67e5988b15877d2807511b262c870b2492548", a.oid);
+    try std.testing.expectEqualStrings(a.oid, header[a.at..][0..40]);
+    const b = it.next().?;
+    try std.testing.expectEqualStrings("37f67e5988b15877d2807511b262c870b2492548", header[b.at..][0..40]);
+    try std.testing.expectEqual(null, it.next());
+}
+
+test "treeOf" {
+    try std.testing.expectEqualStrings("e9054e9ccfee355e80c40ba84abb8f438f9e688b", treeOf("tree e9054e9ccfee355e80c40ba84abb8f438f9e688b\nparent 26f6\n"));
+}
+
+test "tailBlocks" {
+    const header =
+        \\tree e9054e9ccfee355e80c40ba84abb8f438f9e688b
+        \\author Will Leinweber <my@email.com> 1721827347 +0200
+        \\committer Will Leinweber <my@email.com> 1721827347 +0200
+        \\
+    ;
+    try std.testing.expectEqual(2, try tailBlocks(.{ .header = header, .message = "hi\n" }));
+    try std.testing.expectEqual(66, try tailBlocks(.{ .header = header, .message = "x" ** 4096 }));
+}
+
+comptime {
+    std.testing.refAllDecls(@This());
+}
@@ -0,0 +1,104 @@
+const Self = @This();
+const std = @import("std");
+
+// Package energy from Linux powercap. Intel and AMD both show up as
+// intel-rapl:<package>, each with a microjoule counter that wraps at
+// max_energy_range_uj. Since 5.10 the counters are root only on most
+// distributions, so a meter that can't be opened just isn't there.
+
+const root = "/sys/class/powercap";
+const max_packages = 8;
+
+const Package = struct {
+    energy: std.fs.File,
+    range: u64, // the counter wraps here
+};
+
+packages: std.BoundedArray(Package, max_packages) = .{},
+
+pub const Sample = [max_packages]u64;
+
+/// null without readable package counters (not Linux, no RAPL, not root).
+pub fn open() ?Self {
+    var self = Self{};
+    var dir = std.fs.openDirAbsolute(root, .{ .iterate = true }) catch return null;
+    defer dir.close();
+
+    var it = dir.iterate();
+    while (it.next() catch null) |entry| {
+        // packages only, their core/uncore/dram subdomains are included already
+        if (!std.mem.startsWith(u8, entry.name, "intel-rapl:")) continue;
+        if (std.mem.count(u8, entry.name, ":") != 1) continue;
+        if (self.packages.len == max_packages) break;
+
+        var zone = dir.openDir(entry.name, .{}) catch continue;
+        defer zone.close();
+        const energy = zone.openFile("energy_uj", .{}) catch continue;
+        const range = readFile(zone, "max_energy_range_uj") catch {
+            energy.close();
+            continue;
+        };
+        // some kernels only refuse on read
+        if (readCounter(energy) == null) {
+            energy.close();
+            continue;
+        }
+        self.packages.appendAssumeCapacity(.{ .energy = energy, .range = range });
+    }
+
+    if (self.packages.len == 0) return null;
+    return self;
+}
+
+pub fn close(self: *Self) void {
+    for (self.packages.slice()) |p| p.energy.close();
+    self.packages.len = 0;
+}
+
+pub fn read(self: *const Self) Sample {
+    var sample = [_]u64{0} ** max_packages;
+    for (self.packages.constSlice(), 0..) |p, i| sample[i] = readCounter(p.energy) orelse 0;
+    return sample;
+}
+
+/// Joules between two samples, every package summed. A counter that went
+/// down wrapped once, long runs should sample more often than it takes.
+pub fn joules(self: *const Self, start: Sample, end: Sample) f64 {
+    var uj: u64 = 0;
+    for (self.packages.constSlice(), 0..) |p, i| uj += wrapped(start[i], end[i], p.range);
+    return @as(f64, @floatFromInt(uj)) / 1_000_000;
+}
+
+fn wrapped(start: u64, end: u64, range: u64) u64 {
+    return if (end >= start) end - start else range - start + end;
+}
+
+fn readCounter(file: std.fs.File) ?u64 {
+    var buf: [32]u8 = undefined;
+    const n = file.preadAll(&buf, 0) catch return null;
+    return std.fmt.parseUnsigned(u64, std.mem.trimRight(u8, buf[0..n], "\n"), 10) catch null;
+}
+
+fn readFile(dir: std.fs.Dir, name: []const u8) !u64 {
+    const file = try dir.openFile(name, .{});
+    defer file.close();
+    return readCounter(file) orelse error.BadCounter;
+}
+
+test "wrapped" {
+    try std.testing.expectEqual(50, wrapped(100, 150, 1000));
+    try std.testing.expectEqual(150, wrapped(900, 50, 1000));
+}
+
+test "open" {
+    // whatever the host has, it has to come back usable or not at all
+    var meter = open() orelse return error.SkipZigTest;
+    defer meter.close();
+    const a = meter.read();
+    const b = meter.read();
+    try std.testing.expect(meter.joules(a, b) >= 0);
+}
+
+comptime {
+    std.testing.refAllDecls(Self);
+}
@@ -0,0 +1,301 @@
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const Kernel = @import("kernel.zig").Kernel;
+const Goal = @import("goal.zig");
+const FoundFlag = @import("foundFlag.zig");
+const ObjectIndex = @import("objectIndex.zig");
+const Cpu = switch (@import("builtin").os.tag) {
+    .macos => @import("cpu_macos.zig"),
+    else => @import("cpu_other.zig"),
+};
+
+/// Default share of candidates hashed again by the reference path.
+pub const verify_every_default = 1 << 16;
+
+/// One object's search. Spiral indexes are handed out in chunks from `next`
+/// instead of a fixed stride per thread, so threads can join a search that's
+/// already running (range mode moves idle threads onto unfinished commits).
+/// A search that runs out of indexes or is cancelled ends with its best
+/// candidate instead of a match, see `gave_up`.
+pub fn Search(comptime Sha: type) type {
+    return struct {
+        const Self = @This();
+
+        // a multiple of every kernel's lane count
+        pub const chunk = 4096;
+
+        sha: *const Sha,
+        kernel: Kernel,
+        goal: Goal,
+        flag: FoundFlag = .{},
+        // wider than the i32 spiral index so handing out past its end can't wrap
+        next: std.atomic.Value(i64) = std.atomic.Value(i64).init(1),
+        // candidates hashed so far, for progress display
+        hashes: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+        // best score so far in the high half, its spiral index in the low half
+        best: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+        // existing objects a hit mustn't share its prefix with, null skips the
+        // check. Only predicate goals need one, see main's loadKnown
+        known: ?*const ObjectIndex = null,
+        // hits turned down by `known`
+        ambiguous: std.atomic.Value(u32) = std.atomic.Value(u32).init(0),
+        // one candidate in this many is hashed again with `Sha.checkSpiral` to
+        // catch a kernel (or core) that gets it wrong, every hit always is. A
+        // power of two so picking them is a mask, 0 leaves only the hits
+        verify_every: u32 = verify_every_default,
+        // bit per kernel caught with a wrong hash, every thread drops those.
+        // Range points all its searches at one mask so a demotion holds for
+        // the whole run, otherwise the search keeps its own
+        demoted: ?*std.atomic.Value(u32) = null,
+        own_demoted: std.atomic.Value(u32) = std.atomic.Value(u32).init(0),
+        // posted along with `flag` when someone shares a semaphore across searches
+        on_found: ?*std.Thread.Semaphore = null,
+        // set from outside (main's SIGINT handler) to stop at the next chunk
+        cancel: ?*const std.atomic.Value(bool) = null,
+        // the search stopped without a match and `flag.value` is the best
+        // candidate so far, read it once the threads are joined
+        gave_up: bool = false,
+
+        /// Thread body, returns once anyone has found a match.
+        pub fn search(self: *Self, allocator: Allocator) !void {
+            std.debug.assert(self.verify_every == 0 or std.math.isPowerOfTwo(self.verify_every));
+            var kernel = self.effective(self.kernel);
+            var worker = try Sha.Worker.init(self.sha, kernel, allocator);
+            defer worker.deinit(allocator);
+
+            var ns: [Kernel.max_lanes]i32 = undefined;
+            var results: [Kernel.max_lanes]Sha.Digest = undefined;
+            // this thread's best, the shared one is only touched when it improves
+            var best: u8 = 0;
+
+            while (!self.flag.found) {
+                const first = self.next.fetchAdd(chunk, .monotonic);
+                if (first + chunk > std.math.maxInt(i32) or self.cancelled()) {
+                    self.giveUp();
+                    return;
+                }
+                var i: i32 = @intCast(first);
+                const end = i + chunk;
+                while (i < end and !self.flag.found) {
+                    if (self.effective(kernel) != kernel) {
+                        const replacement = try Sha.Worker.init(self.sha, self.effective(kernel), allocator);
+                        worker.deinit(allocator);
+                        worker = replacement;
+                        kernel = worker.kernel;
+                    }
+
+                    const lanes = kernel.lanes();
+                    for (ns[0..lanes]) |*n| {
+                        n.* = i;
+                        i += 1;
+                    }
+                    try worker.run(ns[0..lanes], results[0..lanes]);
+
+                    for (ns[0..lanes], results[0..lanes]) |n, *result| {
+                        const score = self.goal.score(result);
+                        const hit = score >= self.goal.need;
+                        if ((hit or self.sampled(n)) and !try self.verify(kernel, n, result)) {
+                            // nothing from this batch can be trusted, redo it on the fallback
+                            i = ns[0];
+                            break;
+                        }
+                        if (score > best) {
+                            best = score;
+                            self.offerBest(score, n);
+                        }
+                        if (hit and self.unique(result) and self.flag.setFound(n)) {
+                            if (self.on_found) |sem| sem.post();
+                            return;
+                        }
+                    }
+                }
+                _ = self.hashes.fetchAdd(chunk, .monotonic);
+            }
+        }
+
+        fn cancelled(self: *const Self) bool {
+            const cancel = self.cancel orelse return false;
+            return cancel.load(.monotonic);
+        }
+
+        // a goal out of reach (zeros over the whole digest) ends here, with
+        // the spiral used up or on request
+        fn giveUp(self: *Self) void {
+            if (!self.flag.setFound(self.bestSoFar().n)) return;
+            self.gave_up = true;
+            if (self.on_found) |sem| sem.post();
+        }
+
+        fn sampled(self: *const Self, n: i32) bool {
+            return self.verify_every != 0 and @as(u32, @bitCast(n)) & (self.verify_every - 1) == 0;
+        }
+
+        // False when `kernel` got `digest` wrong, it's demoted for the rest of
+        // the run then and the first thread to notice says so.
+        fn verify(self: *Self, kernel: Kernel, n: i32, digest: *const Sha.Digest) !bool {
+            if (kernel == .reference) return true;
+            const expected = try self.sha.checkSpiral(kernel, n);
+            if (std.mem.eql(u8, &expected, digest)) return true;
+
+            const bit = @as(u32, 1) << @intFromEnum(kernel);
+            if (self.demotions().fetchOr(bit, .monotonic) & bit == 0) {
+                var buf: [512]u8 = undefined;
+                std.log.warn("{s} hashed candidate {d} wrong on {s} ({s}), using {s} for the rest of the run", .{
+                    @tagName(kernel),
+                    n,
+                    Cpu.modelName(&buf),
+                    @tagName(@import("builtin").cpu.arch),
+                    @tagName(self.effective(kernel)),
+                });
+            }
+            return false;
+        }
+
+        // `kernel`, or what's left after its demoted fallbacks
+        fn effective(self: *Self, kernel: Kernel) Kernel {
+            const demoted = self.demotions().load(.monotonic);
+            var k = kernel;
+            while (demoted & (@as(u32, 1) << @intFromEnum(k)) != 0) k = fallback(k);
+            return k;
+        }
+
+        fn demotions(self: *Self) *std.atomic.Value(u32) {
+            return self.demoted orelse &self.own_demoted;
+        }
+
+        // only ever called on hits, so the lookup never shows next to hashing
+        fn unique(self: *Self, digest: []const u8) bool {
+            const known = self.known orelse return true;
+            if (!known.ambiguous(digest, self.goal.need)) return true;
+            _ = self.ambiguous.fetchAdd(1, .monotonic);
+            return false;
+        }
+
+        fn offerBest(self: *Self, score: u8, n: i32) void {
+            const new = @as(u64, score) << 32 | @as(u32, @bitCast(n));
+            var current = self.best.load(.monotonic);
+            while (current >> 32 < score) {
+                current = self.best.cmpxchgWeak(current, new, .monotonic, .monotonic) orelse return;
+            }
+        }
+
+        /// The best candidate any thread has seen, 0 (the object as it came
+        /// in) until one scores.
+        pub fn bestSoFar(self: *const Self) struct { score: u8, n: i32 } {
+            const b = self.best.load(.monotonic);
+            return .{ .score = @intCast(b >> 32), .n = @bitCast(@as(u32, @truncate(b))) };
+        }
+    };
+}
+
+// the reference path is the last stop and isn't checked itself. On SHA-NI
+// builds it runs the same sha256rnds2 as sha_ni and scalar, which is why those
+// two are checked against sha256x8.Single rather than against it
+fn fallback(kernel: Kernel) Kernel {
+    return if (kernel == .scalar) .reference else .scalar;
+}
+
+/// Per-search allocations (the object's padded tail, every worker's lane
+/// buffers) in one arena, dropped in one step once the search is done. The
+/// search threads allocate from it concurrently, hence the lock.
+pub const JobArena = struct {
+    arena: std.heap.ArenaAllocator,
+    safe: std.heap.ThreadSafeAllocator = undefined,
+
+    pub fn init(backing: Allocator) JobArena {
+        return .{ .arena = std.heap.ArenaAllocator.init(backing) };
+    }
+
+    /// Call once, `self` can't move afterwards.
+    pub fn allocator(self: *JobArena) Allocator {
+        self.safe = .{ .child_allocator = self.arena.allocator() };
+        return self.safe.allocator();
+    }
+
+    /// Drops everything for the next job but keeps the memory, so reusing
+    /// one doesn't go back to `backing` per job.
+    pub fn reset(self: *JobArena) void {
+        _ = self.arena.reset(.retain_capacity);
+    }
+
+    pub fn deinit(self: *JobArena) void {
+        self.arena.deinit();
+    }
+};
+
+const TestSha = @import("gitSha.zig").GitSha(std.crypto.hash.Sha1);
+
+// the commit every test searches from, with "hi\n" as its message
+const test_header =
+    \\tree e9054e9ccfee355e80c40ba84abb8f438f9e688b
+    \\author Will Leinweber <my@email.com> 1721827347 +0200
+    \\committer Will Leinweber <my@email.com> 1721827347 +0200
+    \\
+;
+
+test "search" {
+    var job = JobArena.init(std.testing.allocator);
+    defer job.deinit();
+    const allocator = job.allocator();
+
+    const sha = try TestSha.initRaw(test_header, "hi\n", allocator);
+    var s = Search(TestSha){ .sha = &sha, .kernel = .scalar, .goal = try Goal.parse("ab", 40) };
+    var threads: [2]std.Thread = undefined;
+    for (&threads) |*t| t.* = try std.Thread.spawn(.{}, Search(TestSha).search, .{ &s, allocator });
+    for (threads) |t| t.join();
+
+    try std.testing.expect(s.flag.found);
+    try std.testing.expect(s.goal.match(&(try sha.trySpiral(s.flag.value))));
+    try std.testing.expectEqual(2, s.bestSoFar().score);
+}
+
+test "search gives up with the best so far" {
+    var job = JobArena.init(std.testing.allocator);
+    defer job.deinit();
+    const allocator = job.allocator();
+    const sha = try TestSha.initRaw(test_header, "hi\n", allocator);
+
+    // one chunk before the spiral index runs out, forty zeros won't happen
+    const S = Search(TestSha);
+    var s = S{ .sha = &sha, .kernel = .scalar, .goal = try Goal.parse("zeros", 40) };
+    s.next.store(std.math.maxInt(i32) - 2 * S.chunk + 1, .monotonic);
+    try s.search(allocator);
+    try std.testing.expect(s.gave_up);
+    try std.testing.expectEqual(s.bestSoFar().n, s.flag.value);
+    try std.testing.expect(s.bestSoFar().score > 0);
+    try std.testing.expectEqual(s.bestSoFar().score, s.goal.score(&(try sha.trySpiral(s.flag.value))));
+
+    // cancelled before anything scored, the object stays as it is
+    const cancel = std.atomic.Value(bool).init(true);
+    var c = S{ .sha = &sha, .kernel = .scalar, .goal = try Goal.parse("zeros", 40), .cancel = &cancel };
+    try c.search(allocator);
+    try std.testing.expect(c.gave_up);
+    try std.testing.expectEqual(0, c.flag.value);
+}
+
+test "verify demotes a kernel that got a hash wrong" {
+    var sha = try TestSha.initRaw(test_header, "hi\n", std.testing.allocator);
+    defer sha.deinit(std.testing.allocator);
+    var s = Search(TestSha){ .sha = &sha, .kernel = .scalar, .goal = try Goal.parse("ab", 40) };
+
+    var digest = try sha.trySpiral(5);
+    try std.testing.expect(try s.verify(.scalar, 5, &digest));
+    try std.testing.expectEqual(.scalar, s.effective(.scalar));
+
+    digest[0] ^= 1;
+    try std.testing.expect(!try s.verify(.scalar, 5, &digest));
+    try std.testing.expectEqual(.reference, s.effective(.scalar));
+    try std.testing.expect(try s.verify(.reference, 5, &digest));
+
+    // searches sharing a mask, like range mode's, stay demoted after the one
+    // that caught it
+    var mask = std.atomic.Value(u32).init(0);
+    var first = Search(TestSha){ .sha = &sha, .kernel = .scalar, .goal = try Goal.parse("ab", 40), .demoted = &mask };
+    try std.testing.expect(!try first.verify(.scalar, 5, &digest));
+    var later = Search(TestSha){ .sha = &sha, .kernel = .scalar, .goal = try Goal.parse("ab", 40), .demoted = &mask };
+    try std.testing.expectEqual(.reference, later.effective(.scalar));
+}
+
+comptime {
+    std.testing.refAllDecls(@This());
+}
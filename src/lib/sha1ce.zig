@@ -0,0 +1,136 @@
+const std = @import("std");
+const builtin = @import("builtin");
+const kernel = @import("kernel.zig");
+
+// SHA-1 on the ARMv8 crypto extension. sha1c/sha1p/sha1m run four rounds on
+// the whole abcd vector, sha1h rotates a into the next e, and
+// sha1su0/sha1su1 extend the message schedule four words at a time. The
+// instructions are only there on aarch64 builds with the sha2 feature
+// (LLVM's name covers SHA-1 too), elsewhere nothing here is compiled.
+
+pub const available = builtin.cpu.arch == .aarch64 and
+    std.Target.aarch64.featureSetHas(builtin.cpu.features, .sha2);
+
+const V = @Vector(4, u32);
+
+const K = [4]u32{ 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6 };
+
+const ce = if (available) struct {
+    // e and the result of sha1h live in lane 0 of a vector register, the
+    // :s modifier names its low 32 bits
+    inline fn rounds(comptime op: []const u8, abcd: V, e: V, wk: V) V {
+        return asm (op ++ " %[abcd:q], %[e:s], %[wk].4s"
+            : [abcd] "=w" (-> V),
+            : [_] "0" (abcd),
+              [e] "w" (e),
+              [wk] "w" (wk),
+        );
+    }
+
+    inline fn nextE(abcd: V) V {
+        return asm ("sha1h %[e:s], %[abcd:s]"
+            : [e] "=w" (-> V),
+            : [abcd] "w" (abcd),
+        );
+    }
+
+    inline fn schedule(w0: V, w1: V, w2: V, w3: V) V {
+        return asm (
+            \\sha1su0 %[w].4s, %[w1].4s, %[w2].4s
+            \\sha1su1 %[w].4s, %[w3].4s
+            : [w] "=w" (-> V),
+            : [_] "0" (w0),
+              [w1] "w" (w1),
+              [w2] "w" (w2),
+              [w3] "w" (w3),
+        );
+    }
+
+    fn compress(state: *[5]u32, block: *const [64]u8) void {
+        var w: [4]V = undefined;
+        for (0..4) |i| {
+            var words: [4]u32 = undefined;
+            for (0..4) |j| words[j] = std.mem.readInt(u32, block[i * 16 + j * 4 ..][0..4], .big);
+            w[i] = words;
+        }
+
+        var abcd: V = state[0..4].*;
+        var e: V = .{ state[4], 0, 0, 0 };
+
+        // twenty groups of four rounds, w[g % 4] holds words 4g..4g+3
+        inline for (0..20) |g| {
+            if (g >= 4) w[g % 4] = schedule(w[g % 4], w[(g + 1) % 4], w[(g + 2) % 4], w[(g + 3) % 4]);
+            const wk = w[g % 4] +% @as(V, @splat(K[g / 5]));
+            const e_next = nextE(abcd);
+            abcd = rounds(switch (g / 5) {
+                0 => "sha1c",
+                2 => "sha1m",
+                else => "sha1p",
+            }, abcd, e, wk);
+            e = e_next;
+        }
+
+        const words: [4]u32 = abcd;
+        for (0..4) |i| state[i] +%= words[i];
+        state[4] +%= e[0];
+    }
+} else struct {};
+
+// keeps digest compiling everywhere, callers check `available`
+const compress = if (available) ce.compress else unsupported;
+
+fn unsupported(state: *[5]u32, block: *const [64]u8) void {
+    _ = state;
+    _ = block;
+    unreachable;
+}
+
+/// Finishes a padded message (whole blocks) from `midstate`.
+pub fn digest(midstate: [5]u32, padded: []const u8) [20]u8 {
+    std.debug.assert(padded.len % 64 == 0);
+
+    var state = midstate;
+    var offset: usize = 0;
+    while (offset < padded.len) : (offset += 64) compress(&state, padded[offset..][0..64]);
+
+    var out: [20]u8 = undefined;
+    for (0..5) |i| std.mem.writeInt(u32, out[i * 4 ..][0..4], state[i], .big);
+    return out;
+}
+
+test "digest matches std Sha1" {
+    if (!available) return error.SkipZigTest;
+    const Sha1 = std.crypto.hash.Sha1;
+
+    inline for (.{ "abc", "a message long enough to need a second block once it has been padded out" }) |in| {
+        var buf: [kernel.paddedLength(in.len)]u8 = undefined;
+        @memcpy(buf[0..in.len], in);
+        kernel.pad(&buf, in.len, in.len);
+
+        var expected: [20]u8 = undefined;
+        Sha1.hash(in, &expected, .{});
+        try std.testing.expectEqual(expected, digest(Sha1.init(.{}).s, &buf));
+    }
+}
+
+test "digest continues from a midstate across blocks" {
+    if (!available) return error.SkipZigTest;
+    const Sha1 = std.crypto.hash.Sha1;
+    const prefix = "x" ** 64;
+    const tail = "1721827347 and then a message that runs well past the first block boundary\n";
+
+    var h = Sha1.init(.{});
+    h.update(prefix);
+
+    var buf: [kernel.paddedLength(tail.len)]u8 = undefined;
+    @memcpy(buf[0..tail.len], tail);
+    kernel.pad(&buf, tail.len, prefix.len + tail.len);
+
+    var expected: [20]u8 = undefined;
+    Sha1.hash(prefix ++ tail, &expected, .{});
+    try std.testing.expectEqual(expected, digest(h.s, &buf));
+}
+
+comptime {
+    std.testing.refAllDecls(@This());
+}
@@ -0,0 +1,132 @@
+const std = @import("std");
+const builtin = @import("builtin");
+const kernel = @import("kernel.zig");
+const K = @import("sha256x8.zig").K;
+
+// SHA-256 on the x86 SHA extensions. sha256rnds2 runs two rounds on the state
+// split into its ABEF and CDGH halves, with the round constants plus message
+// words in xmm0, and sha256msg1/sha256msg2 extend the message schedule four
+// words at a time. Built where std's Sha256 uses the same instructions (sha
+// and avx2), elsewhere nothing here is compiled.
+
+pub const available = builtin.cpu.arch == .x86_64 and
+    std.Target.x86.featureSetHasAll(builtin.cpu.features, .{ .sha, .avx2 });
+
+const V = @Vector(4, u32);
+
+const ni = if (available) struct {
+    // two rounds on `half`, `other` is the rest of the state and `wk` only
+    // counts in its low two words
+    inline fn rounds(half: V, other: V, wk: V) V {
+        return asm ("sha256rnds2 %[other], %[half]"
+            : [half] "=x" (-> V),
+            : [_] "0" (half),
+              [other] "x" (other),
+              [_] "{xmm0}" (wk),
+        );
+    }
+
+    // the next four words from the sixteen before them, oldest first
+    inline fn schedule(w0: V, w1: V, w2: V, w3: V) V {
+        const partial = asm ("sha256msg1 %[w1], %[w0]"
+            : [w0] "=x" (-> V),
+            : [_] "0" (w0),
+              [w1] "x" (w1),
+        );
+        // the words seven back straddle w2 and w3
+        const seven_back = @shuffle(u32, w2, w3, [4]i32{ 1, 2, 3, -1 });
+        return asm ("sha256msg2 %[w3], %[w]"
+            : [w] "=x" (-> V),
+            : [_] "0" (partial +% seven_back),
+              [w3] "x" (w3),
+        );
+    }
+
+    fn compress(state: *[8]u32, block: *const [64]u8) void {
+        var w: [4]V = undefined;
+        for (0..4) |i| {
+            var words: [4]u32 = undefined;
+            for (0..4) |j| words[j] = std.mem.readInt(u32, block[i * 16 + j * 4 ..][0..4], .big);
+            w[i] = words;
+        }
+
+        var abef: V = .{ state[5], state[4], state[1], state[0] };
+        var cdgh: V = .{ state[7], state[6], state[3], state[2] };
+
+        // sixteen groups of four rounds, w[g % 4] holds words 4g..4g+3
+        inline for (0..16) |g| {
+            if (g >= 4) w[g % 4] = schedule(w[g % 4], w[(g + 1) % 4], w[(g + 2) % 4], w[(g + 3) % 4]);
+            const wk = w[g % 4] +% @as(V, K[4 * g ..][0..4].*);
+            cdgh = rounds(cdgh, abef, wk);
+            abef = rounds(abef, cdgh, @shuffle(u32, wk, undefined, [4]i32{ 2, 3, 2, 3 }));
+        }
+
+        state[0] +%= abef[3];
+        state[1] +%= abef[2];
+        state[4] +%= abef[1];
+        state[5] +%= abef[0];
+        state[2] +%= cdgh[3];
+        state[3] +%= cdgh[2];
+        state[6] +%= cdgh[1];
+        state[7] +%= cdgh[0];
+    }
+} else struct {};
+
+// keeps digest compiling everywhere, callers check `available`
+const compress = if (available) ni.compress else unsupported;
+
+fn unsupported(state: *[8]u32, block: *const [64]u8) void {
+    _ = state;
+    _ = block;
+    unreachable;
+}
+
+/// Finishes a padded message (whole blocks) from `midstate`.
+pub fn digest(midstate: [8]u32, padded: []const u8) [32]u8 {
+    std.debug.assert(padded.len % 64 == 0);
+
+    var state = midstate;
+    var offset: usize = 0;
+    while (offset < padded.len) : (offset += 64) compress(&state, padded[offset..][0..64]);
+
+    var out: [32]u8 = undefined;
+    for (0..8) |i| std.mem.writeInt(u32, out[i * 4 ..][0..4], state[i], .big);
+    return out;
+}
+
+test "digest matches std Sha256" {
+    if (!available) return error.SkipZigTest;
+    const Sha256 = std.crypto.hash.sha2.Sha256;
+
+    inline for (.{ "abc", "a message long enough to need a second block once it has been padded out" }) |in| {
+        var buf: [kernel.paddedLength(in.len)]u8 = undefined;
+        @memcpy(buf[0..in.len], in);
+        kernel.pad(&buf, in.len, in.len);
+
+        var expected: [32]u8 = undefined;
+        Sha256.hash(in, &expected, .{});
+        try std.testing.expectEqual(expected, digest(Sha256.init(.{}).s, &buf));
+    }
+}
+
+test "digest continues from a midstate across blocks" {
+    if (!available) return error.SkipZigTest;
+    const Sha256 = std.crypto.hash.sha2.Sha256;
+    const prefix = "x" ** 64;
+    const tail = "1721827347 and then a message that runs well past the first block boundary\n";
+
+    var h = Sha256.init(.{});
+    h.update(prefix);
+
+    var buf: [kernel.paddedLength(tail.len)]u8 = undefined;
+    @memcpy(buf[0..tail.len], tail);
+    kernel.pad(&buf, tail.len, prefix.len + tail.len);
+
+    var expected: [32]u8 = undefined;
+    Sha256.hash(prefix ++ tail, &expected, .{});
+    try std.testing.expectEqual(expected, digest(h.s, &buf));
+}
+
+comptime {
+    std.testing.refAllDecls(@This());
+}
@@ -0,0 +1,247 @@
+const std = @import("std");
+const kernel = @import("kernel.zig");
+
+// Eight SHA-256 streams side by side, one per u32 lane of a 256-bit vector.
+// With AVX2 every line of the compression function below is a single
+// instruction for all eight candidates.
+
+pub const lanes = 8;
+const V = @Vector(lanes, u32);
+
+pub const iv = [8]u32{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+
+pub const K = [64]u32{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+inline fn rotr(x: anytype, comptime n: u32) @TypeOf(x) {
+    const Shift = @Vector(@typeInfo(@TypeOf(x)).Vector.len, u5);
+    const r: Shift = @splat(@as(u5, n));
+    const l: Shift = @splat(@as(u5, 32 - n));
+    return (x >> r) | (x << l);
+}
+
+inline fn shr(x: anytype, comptime n: u32) @TypeOf(x) {
+    const Shift = @Vector(@typeInfo(@TypeOf(x)).Vector.len, u5);
+    const r: Shift = @splat(@as(u5, n));
+    return x >> r;
+}
+
+// generic over the lane count so `Single` can run the same rounds at one
+fn compress(comptime n: usize, state: *[8]@Vector(n, u32), block: *const [16]@Vector(n, u32)) void {
+    const W = @Vector(n, u32);
+    var w: [64]W = undefined;
+    @memcpy(w[0..16], block);
+    for (16..64) |i| {
+        const s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ shr(w[i - 15], 3);
+        const s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ shr(w[i - 2], 10);
+        w[i] = w[i - 16] +% s0 +% w[i - 7] +% s1;
+    }
+
+    var a = state[0];
+    var b = state[1];
+    var c = state[2];
+    var d = state[3];
+    var e = state[4];
+    var f = state[5];
+    var g = state[6];
+    var h = state[7];
+
+    inline for (0..64) |i| {
+        const s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        const ch = (e & f) ^ (~e & g);
+        const t1 = h +% s1 +% ch +% @as(W, @splat(K[i])) +% w[i];
+        const s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        const maj = (a & b) ^ (a & c) ^ (b & c);
+        h = g;
+        g = f;
+        f = e;
+        e = d +% t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 +% s0 +% maj;
+    }
+
+    state[0] +%= a;
+    state[1] +%= b;
+    state[2] +%= c;
+    state[3] +%= d;
+    state[4] +%= e;
+    state[5] +%= f;
+    state[6] +%= g;
+    state[7] +%= h;
+}
+
+fn loadWord(msg: []const u8, at: usize) u32 {
+    return std.mem.readInt(u32, msg[at..][0..4], .big);
+}
+
+// Hashes eight padded messages of the same length that all continue from
+// `midstate`. Only bytes in [varying_start, varying_end) differ between lanes,
+// every other block is read once from lane 0 and broadcast.
+pub fn digests(
+    midstate: [8]u32,
+    msgs: *const [lanes][]const u8,
+    varying_start: usize,
+    varying_end: usize,
+    out: *[lanes][32]u8,
+) void {
+    const len = msgs[0].len;
+    std.debug.assert(len % 64 == 0);
+
+    var state: [8]V = undefined;
+    for (0..8) |i| state[i] = @splat(midstate[i]);
+
+    var block: [16]V = undefined;
+    var offset: usize = 0;
+    while (offset < len) : (offset += 64) {
+        const shared = offset + 64 <= varying_start or offset >= varying_end;
+        for (0..16) |t| {
+            const at = offset + t * 4;
+            if (shared) {
+                block[t] = @splat(loadWord(msgs[0], at));
+            } else {
+                var words: [lanes]u32 = undefined;
+                for (0..lanes) |l| words[l] = loadWord(msgs[l], at);
+                block[t] = words;
+            }
+        }
+        compress(lanes, &state, &block);
+    }
+
+    for (0..8) |i| {
+        const words: [lanes]u32 = state[i];
+        for (0..lanes) |l| std.mem.writeInt(u32, out[l][i * 4 ..][0..4], words[l], .big);
+    }
+}
+
+/// One SHA-256 stream through the rounds above at a single lane, fed like
+/// std's hasher. It's plain u32 arithmetic where std's Sha256 compresses
+/// with sha256rnds2 on SHA-NI builds, so scalar (std's code) and sha_ni (the
+/// same instructions) are checked against this instead, see GitSha.checkSpiral.
+pub const Single = struct {
+    s: [8]u32,
+    buf: [64]u8 = undefined,
+    buf_len: usize = 0,
+    total_len: u64 = 0,
+
+    /// Picks up where a std hasher is, midstate and unabsorbed bytes.
+    pub fn from(h: std.crypto.hash.sha2.Sha256) Single {
+        var single = Single{ .s = h.s, .buf_len = h.buf_len, .total_len = h.total_len };
+        @memcpy(single.buf[0..h.buf_len], h.buf[0..h.buf_len]);
+        return single;
+    }
+
+    pub fn update(self: *Single, bytes: []const u8) void {
+        var rest = bytes;
+        self.total_len += rest.len;
+        while (rest.len > 0) {
+            const take = @min(64 - self.buf_len, rest.len);
+            @memcpy(self.buf[self.buf_len..][0..take], rest[0..take]);
+            self.buf_len += take;
+            rest = rest[take..];
+            if (self.buf_len == 64) {
+                self.block(&self.buf);
+                self.buf_len = 0;
+            }
+        }
+    }
+
+    pub fn final(self: *Single, out: *[32]u8) void {
+        var last: [128]u8 = undefined;
+        const padded = last[0..kernel.paddedLength(self.buf_len)];
+        @memcpy(padded[0..self.buf_len], self.buf[0..self.buf_len]);
+        kernel.pad(padded, self.buf_len, self.total_len);
+        self.block(padded[0..64]);
+        if (padded.len > 64) self.block(padded[64..128]);
+        for (self.s, 0..) |word, i| std.mem.writeInt(u32, out[i * 4 ..][0..4], word, .big);
+    }
+
+    fn block(self: *Single, bytes: *const [64]u8) void {
+        var state: [8]@Vector(1, u32) = undefined;
+        for (0..8) |i| state[i] = @splat(self.s[i]);
+        var words: [16]@Vector(1, u32) = undefined;
+        for (0..16) |t| words[t] = @splat(loadWord(bytes, t * 4));
+        compress(1, &state, &words);
+        for (0..8) |i| self.s[i] = state[i][0];
+    }
+};
+
+test "digests match std Sha256" {
+    const Sha256 = std.crypto.hash.sha2.Sha256;
+    const inputs = [lanes][]const u8{ "abc", "abd", "abe", "abf", "abg", "abh", "abi", "abj" };
+
+    var bufs: [lanes][64]u8 = undefined;
+    var msgs: [lanes][]const u8 = undefined;
+    for (inputs, 0..) |in, l| {
+        @memcpy(bufs[l][0..in.len], in);
+        kernel.pad(&bufs[l], in.len, in.len);
+        msgs[l] = &bufs[l];
+    }
+
+    var out: [lanes][32]u8 = undefined;
+    digests(iv, &msgs, 2, 3, &out);
+
+    for (inputs, out) |in, got| {
+        var expected: [32]u8 = undefined;
+        Sha256.hash(in, &expected, .{});
+        try std.testing.expectEqual(expected, got);
+    }
+}
+
+test "digests continue from a midstate across shared blocks" {
+    const Sha256 = std.crypto.hash.sha2.Sha256;
+    const prefix = "x" ** 64;
+    const tail = "1721827347 and then a message that runs well past the first block boundary\n";
+
+    var h = Sha256.init(.{});
+    h.update(prefix);
+
+    var buf: [kernel.paddedLength(tail.len)]u8 = undefined;
+    @memcpy(buf[0..tail.len], tail);
+    kernel.pad(&buf, tail.len, prefix.len + tail.len);
+    const msgs = [_][]const u8{&buf} ** lanes;
+
+    var out: [lanes][32]u8 = undefined;
+    digests(h.s, &msgs, 0, 10, &out);
+
+    var expected: [32]u8 = undefined;
+    Sha256.hash(prefix ++ tail, &expected, .{});
+    for (out) |got| try std.testing.expectEqual(expected, got);
+}
+
+test "Single matches std Sha256 from a midstate" {
+    const Sha256 = std.crypto.hash.sha2.Sha256;
+    const prefix = "x" ** 70;
+    // 6 bytes already buffered: a tail that pads in one block, one that
+    // needs two, and one that fills a block on the way
+    inline for (.{
+        "short tail\n",
+        "a tail that lands past the cut, two padding blocks\n",
+        "a tail that runs past the end of the buffered block and then some\n",
+    }) |tail| {
+        var h = Sha256.init(.{});
+        h.update(prefix);
+        var single = Single.from(h);
+        single.update(tail[0..3]);
+        single.update(tail[3..]);
+
+        var got: [32]u8 = undefined;
+        single.final(&got);
+        var expected: [32]u8 = undefined;
+        Sha256.hash(prefix ++ tail, &expected, .{});
+        try std.testing.expectEqual(expected, got);
+    }
+}
+
+comptime {
+    std.testing.refAllDecls(@This());
+}
@@ -2,8 +2,8 @@ const std = @import("std");
 const Git = @import("git.zig");
 
 const Self = @This();
-const MaxSize = 40;
-buf: [20]u8 = undefined,
+const MaxSize = 64; // sha256, sha1 targets are checked against the repo in main
+buf: [32]u8 = undefined,
 buf_len: u8 = 0,
 half: bool = false,
 
@@ -32,7 +32,7 @@ pub fn _init(str: []const u8) TargetError!Self {
     if (str.len > MaxSize) return TargetError.TooLong;
 
     var half = false;
-    var buf: [20]u8 = undefined;
+    var buf: [32]u8 = undefined;
     var i: u8 = 0;
 
     var itr = std.mem.window(u8, str, 2, 2);
@@ -85,10 +85,21 @@ test "_init" {
 
     try std.testing.expectError(TargetError.NotHexChr, Self._init("great"));
     try std.testing.expectError(TargetError.NoInput, Self._init(""));
-    try std.testing.expectError(TargetError.TooLong, Self._init("123345" ** 9));
+    try std.testing.expectError(TargetError.TooLong, Self._init("123345" ** 11));
 }
 
-pub fn match(self: *const Self, other: *const [20]u8) bool {
+// number of hex characters the target asks for
+pub fn hexLen(self: *const Self) usize {
+    return @as(usize, self.buf_len) * 2 - @intFromBool(self.half);
+}
+
+test "hexLen" {
+    try std.testing.expectEqual(6, (try Self._init("cafe12")).hexLen());
+    try std.testing.expectEqual(3, (try Self._init("123")).hexLen());
+    try std.testing.expectEqual(64, (try Self._init("ab" ** 32)).hexLen());
+}
+
+pub fn match(self: *const Self, other: []const u8) bool {
     const stop = self.buf_len - 1;
 
     for (0..stop) |i| {
@@ -135,6 +146,16 @@ test "match" {
     try std.testing.expectEqual(false, t.match(&result));
 }
 
+test "match sha256" {
+    var result = [_]u8{0xab} ** 32;
+    result[31] = 0xcd;
+
+    var t = try Self._init("ab" ** 31 ++ "cd");
+    try std.testing.expectEqual(true, t.match(&result));
+    t = try Self._init("ab" ** 31 ++ "ce");
+    try std.testing.expectEqual(false, t.match(&result));
+}
+
 pub fn format(
     self: *const Self,
     comptime fmt: []const u8,
@@ -2,90 +2,219 @@ const std = @import("std");
 
 const lib = @import("lib.zig");
 const GitSha = lib.GitSha;
-const Target = lib.Target;
+const Goal = lib.Goal;
 const Git = lib.Git;
-
-var GlobalFoundFlag = lib.FoundFlag{};
+const Kernel = lib.Kernel;
 
 pub fn main() !void {
     var gpa = std.heap.GeneralPurposeAllocator(.{}){};
     const allocator = gpa.allocator();
 
+    var args = std.process.args();
+    _ = args.skip();
+    const command = args.next();
+    if (command) |cmd| {
+        if (std.mem.eql(u8, cmd, "bench")) {
+            var options = lib.Bench.Options{ .threads = lib.Cpu.getPerfCores() };
+            if (args.next()) |hashes| options.hashes = try std.fmt.parseUnsigned(u64, hashes, 10);
+            return lib.Bench.run(allocator, options);
+        }
+        if (std.mem.eql(u8, cmd, "corpus")) {
+            // raw commit body of a bench layout, for feeding other implementations
+            const name = args.next() orelse return error.NoLayout;
+            const format = try lib.ObjectFormat.parse(args.next() orelse "sha1");
+            const layout = try lib.Corpus.generateNamed(allocator, name, format);
+            const out = std.io.getStdOut().writer();
+            try out.print("{s}\n{s}", .{ layout.header, layout.message });
+            return;
+        }
+    }
+
+    // everything libgit2 allocates from here on is one job, range mode ends
+    // one per commit, see GitAlloc
+    var git_alloc = lib.GitAlloc.init(std.heap.page_allocator);
+    defer git_alloc.deinit();
+    try git_alloc.install();
+
     var git = try Git.init();
-    const target = try Target.init(&git);
-    const sha = try GitSha.init(&git, allocator);
+    if (command != null and std.mem.eql(u8, command.?, "audit")) {
+        // `git-vain audit <a>..<b> [pattern...] [--drift]`
+        const range_arg = try allocator.dupeZ(u8, args.next() orelse return error.NoRange);
+        defer allocator.free(range_arg);
+        var patterns = std.ArrayList([]const u8).init(allocator);
+        defer patterns.deinit();
+        var drift = false;
+        while (args.next()) |arg| {
+            if (std.mem.eql(u8, arg, "--drift")) drift = true else try patterns.append(arg);
+        }
+        if (patterns.items.len == 0) try patterns.append(git.getDefault());
+
+        try lib.Audit.run(&git, range_arg, .{ .patterns = patterns.items, .drift = drift, .threads = lib.Cpu.getPerfCores() }, allocator);
+        git.deinit();
+        return;
+    }
+
+    var goal: Goal = undefined;
+    const hex_len = git.format.hexLength();
+    var ref: ?[:0]u8 = null;
+    defer if (ref) |r| allocator.free(r);
+    var range: ?[:0]u8 = null;
+    defer if (range) |r| allocator.free(r);
+
+    if (command != null and std.mem.eql(u8, command.?, "tag")) {
+        // `git-vain tag <name> [target]` rewrites the annotated tag's tagger time
+        const name = args.next() orelse return error.NoTagName;
+        ref = try std.fmt.allocPrintZ(allocator, "refs/tags/{s}", .{name});
+        goal = try Goal.parse(args.next() orelse git.getDefault(), hex_len);
+    } else if (command != null and std.mem.eql(u8, command.?, "range")) {
+        // `git-vain range <a>..<b> [target]` rewrites every commit in the range
+        range = try allocator.dupeZ(u8, args.next() orelse return error.NoRange);
+        goal = try Goal.parse(args.next() orelse git.getDefault(), hex_len);
+    } else {
+        // a hex prefix or a predicate like `digits:12`, see Goal
+        goal = try Goal.parse(command orelse git.getDefault(), hex_len);
+    }
+
+    // candidates re-hashed by the reference path, one in this many rounded up
+    // to a power of two (0: hits only)
+    const verify_every: u32 = if (try git.configInt("vain.verify")) |v| blk: {
+        const every = std.math.cast(u32, v) orelse return error.BadVerify;
+        break :blk if (every == 0) 0 else std.math.ceilPowerOfTwo(u32, every) catch return error.BadVerify;
+    } else lib.verify_every_default;
+
+    if (range) |r| {
+        // checked against what's there already, but every rewritten commit
+        // gets the same prefix, so only a longer one tells them apart
+        var known = try loadKnown(&git, goal, allocator);
+        defer if (known) |*k| k.deinit();
+        if (goal.kind == .prefix) std.debug.print("range: the rewritten commits will all start with {any}\n", .{goal});
+        switch (git.format) {
+            inline else => |format| try lib.Range(GitSha(format.Hash())).run(&git, &git_alloc, r, goal, if (known) |*k| k else null, verify_every, lib.Cpu.getPerfCores(), allocator),
+        }
+    } else {
+        try vain(&git, goal, verify_every, ref, allocator);
+    }
+
+    git.deinit();
+    git_alloc.reset().log("{s}", .{if (range != null) "range, last job" else "search"});
+}
 
-    if (target.match(&sha.startingSha)) {
+// Existing objects for the per-hit ambiguity check of a predicate goal. Every
+// hit of a prefix goal starts with the same prefix, so one lookup here settles
+// it for all of them: nothing starts with it and no hit can be ambiguous, or
+// something does and every hit would be.
+fn loadKnown(git: *Git, goal: Goal, allocator: std.mem.Allocator) !?lib.ObjectIndex {
+    const dir = try git.objectsDir(allocator);
+    defer allocator.free(dir);
+    var known = try lib.ObjectIndex.init(dir, git.format.hexLength() / 2, allocator);
+    if (goal.kind != .prefix) return known;
+    defer known.deinit();
+
+    const prefix = goal.prefix();
+    if (known.ambiguous(&prefix, goal.need)) {
+        std.debug.print("objects starting with {any} exist already, any hit would be ambiguous, use a longer prefix\n", .{goal});
+        return error.AmbiguousPrefix;
+    }
+    return null;
+}
+
+// `ref` is an annotated tag to rewrite, HEAD's commit when null
+fn vain(git: *Git, goal: Goal, verify_every: u32, ref: ?[:0]const u8, allocator: std.mem.Allocator) !void {
+    switch (git.format) {
+        inline else => |format| try run(GitSha(format.Hash()), git, goal, verify_every, ref, allocator),
+    }
+}
+
+fn run(comptime Sha: type, git: *Git, goal: Goal, verify_every: u32, ref: ?[:0]const u8, gpa: std.mem.Allocator) !void {
+    // the tail, the borrowed object and every worker's lanes go in one step
+    var job = lib.JobArena.init(gpa);
+    defer job.deinit();
+    const allocator = job.allocator();
+
+    var sha = if (ref) |r| try Sha.initTag(git, r, allocator) else try Sha.init(git, allocator);
+    defer sha.deinit(allocator);
+
+    if (goal.match(&sha.startingSha)) {
         std.debug.print("already at target: ", .{});
-        printSha(sha.startingSha, target);
+        printSha(&sha.startingSha, goal.highlight(&sha.startingSha));
         std.process.exit(0);
     }
+    // after that check, an object already at target would be ambiguous with itself
+    var known = try loadKnown(git, goal, gpa);
+    defer if (known) |*k| k.deinit();
+
+    var search = lib.Search(Sha){ .sha = &sha, .kernel = Kernel.best(Sha.object_format), .goal = goal, .known = if (known) |*k| k else null, .verify_every = verify_every, .cancel = &interrupted };
+    // a goal like `zeros` has no end, ^C stops it with the best candidate so
+    // far. A prefix half matched is no use, ^C just ends the process there
+    if (goal.keepsBest()) {
+        try std.posix.sigaction(std.posix.SIG.INT, &.{ .handler = .{ .handler = onInterrupt }, .mask = std.posix.empty_sigset, .flags = 0 }, null);
+    }
 
+    var handles: [std.math.maxInt(u8)]std.Thread = undefined;
     const thread_count = lib.Cpu.getPerfCores();
-    var counts = try allocator.alloc(i32, thread_count);
-    for (0..thread_count) |i| {
-        const start: i32 = @intCast(i + 1);
-        counts[i] = 0;
-        const handle = try std.Thread.spawn(.{}, search, .{ start, thread_count, &sha, target, &(counts[i]) });
-        handle.detach();
+    for (handles[0..thread_count]) |*handle| {
+        handle.* = try std.Thread.spawn(.{}, lib.Search(Sha).search, .{ &search, allocator });
     }
 
-    {
-        const handle = try std.Thread.spawn(.{}, display, .{ &counts, target });
-        handle.detach();
+    // joined before `search` goes away with this frame
+    var display_done = std.Thread.ResetEvent{};
+    const display_thread = try std.Thread.spawn(.{}, display, .{ Sha, &search, &display_done });
+
+    search.flag.wait();
+    // they stop within a batch, and their lanes live in `job`
+    for (handles[0..thread_count]) |handle| handle.join();
+    display_done.set();
+    display_thread.join();
+    const skipped = search.ambiguous.load(.monotonic);
+    if (skipped > 0) std.debug.print("skipped {d} hits with an ambiguous prefix\n", .{skipped});
+
+    if (search.gave_up) {
+        const best = search.bestSoFar();
+        std.debug.print("\nstopped, best {d}/{d} at {d}\n", .{ best.score, goal.need, best.n });
+        // only the spiral running out gets a prefix goal here
+        if (!goal.keepsBest()) return error.NoMatch;
+        if (best.score <= goal.score(&sha.startingSha)) {
+            std.debug.print("nothing better than the object as it is, leaving it\n", .{});
+            return;
+        }
     }
+    std.debug.print("{s}: {d}, ", .{ if (search.gave_up) "best" else "found", search.flag.value });
 
-    GlobalFoundFlag.wait();
-    std.debug.print("found: {d}, ", .{GlobalFoundFlag.value});
-
-    const oid = try sha.amend(GlobalFoundFlag.value);
-    printSha(oid.id, target);
+    const oid = try sha.amend(search.flag.value, allocator);
+    printSha(&oid, goal.highlight(&oid));
 }
 
-fn printSha(sha: [20]u8, target: Target) void {
-    const bold_len = target.buf_len;
-    const last_maybe_bold = bold_len - 1;
+// set by ^C, see Search.cancel
+var interrupted = std.atomic.Value(bool).init(false);
 
-    std.debug.print("\x1b[1;4m", .{});
-    for (sha[0..last_maybe_bold]) |c| std.debug.print("{x}", .{c});
+fn onInterrupt(sig: i32) callconv(.C) void {
+    _ = sig;
+    interrupted.store(true, .monotonic);
+}
 
-    if (target.half) {
-        const c = sha[last_maybe_bold];
-        std.debug.print("{x}", .{c >> 4});
-        std.debug.print("\x1b[0m", .{});
-        std.debug.print("{x}", .{c << 4 >> 4});
-    } else {
-        std.debug.print("{x}", .{sha[last_maybe_bold]});
-        std.debug.print("\x1b[0m", .{});
+// the first `bold` nibbles are underlined
+fn printSha(sha: []const u8, bold: usize) void {
+    std.debug.print("\x1b[1;4m", .{});
+    for (0..sha.len * 2) |i| {
+        if (i == bold) std.debug.print("\x1b[0m", .{});
+        const c = sha[i / 2];
+        std.debug.print("{x}", .{if (i % 2 == 0) c >> 4 else c & 0xf});
     }
-
-    for (sha[bold_len..]) |c| std.debug.print("{x}", .{c});
+    if (bold >= sha.len * 2) std.debug.print("\x1b[0m", .{});
     std.debug.print("\n", .{});
 }
 
-fn display(counts: *[]i32, target: Target) void {
+// a line a second until `done` is set
+fn display(comptime Sha: type, search: *const lib.Search(Sha), done: *std.Thread.ResetEvent) void {
     var last: u64 = 0;
-    while (!GlobalFoundFlag.found) {
-        var sum: u64 = 0;
-        for (counts.*) |c| sum += @intCast(c);
+    while (!search.flag.found) {
+        const sum = search.hashes.load(.monotonic);
         const mhash = @as(f64, @floatFromInt(sum - last)) / 1_000_000;
-        std.debug.print("{any}: {d}khash, {d:.1} Mh/s\r", .{ target, sum / 1000, mhash });
+        const best = search.bestSoFar();
+        std.debug.print("{any}: {d}khash, {d:.1} Mh/s, best {d}/{d} at {d}\r", .{ search.goal, sum / 1000, mhash, best.score, search.goal.need, best.n });
         last = sum;
-        std.time.sleep(std.time.ns_per_s);
-    }
-}
-
-fn search(start: i32, step: u8, sha: *const GitSha, target: Target, counter: *i32) !void {
-    var i = start;
-    var next_count_write: i32 = 0;
-
-    while (!GlobalFoundFlag.found) : (i += step) {
-        const result = try sha.trySpiral(i);
-        if (i > next_count_write) {
-            counter.* = @divTrunc(i - start, step);
-            next_count_write += 100_000;
-        }
-        if (target.match(&result) and GlobalFoundFlag.setFound(i)) break;
+        done.timedWait(std.time.ns_per_s) catch continue;
+        return;
     }
 }
 
@@ -116,6 +116,7 @@ pub const ObjectType = object.ObjectType;
 
 const odb = @import("odb.zig");
 pub const Odb = odb.Odb;
+pub const OdbObject = odb.OdbObject;
 
 const oid = @import("oid.zig");
 pub const Oid = oid.Oid;
@@ -25,6 +25,72 @@ pub const Odb = opaque {
         return repo;
     }
 
+    /// Read an object from the database.
+    ///
+    /// The returned object should be released with `OdbObject.deinit()` when no longer needed.
+    ///
+    /// ## Parameters
+    /// * `id` - Identity of the object to read.
+    pub fn read(self: *Odb, id: *const git.Oid) !*OdbObject {
+        if (internal.trace_log) log.debug("Odb.read called", .{});
+
+        var obj: *OdbObject = undefined;
+
+        try internal.wrapCall("git_odb_read", .{
+            @as(*?*c.git_odb_object, @ptrCast(&obj)),
+            @as(*c.git_odb, @ptrCast(self)),
+            @as(*const c.git_oid, @ptrCast(id)),
+        });
+
+        return obj;
+    }
+
+    /// Write an object directly into the database.
+    ///
+    /// The data is not validated, it is written as an object of type `object_type` as is.
+    ///
+    /// ## Parameters
+    /// * `data` - Buffer with the data to store.
+    /// * `object_type` - Type of the data to store.
+    pub fn write(self: *Odb, data: []const u8, object_type: git.ObjectType) !git.Oid {
+        if (internal.trace_log) log.debug("Odb.write called", .{});
+
+        var oid: git.Oid = undefined;
+
+        try internal.wrapCall("git_odb_write", .{
+            @as(*c.git_oid, @ptrCast(&oid)),
+            @as(*c.git_odb, @ptrCast(self)),
+            data.ptr,
+            data.len,
+            @intFromEnum(object_type),
+        });
+
+        return oid;
+    }
+
+    comptime {
+        std.testing.refAllDecls(@This());
+    }
+};
+
+/// An object read from the database, owns its data.
+pub const OdbObject = opaque {
+    pub fn deinit(self: *OdbObject) void {
+        if (internal.trace_log) log.debug("OdbObject.deinit called", .{});
+
+        c.git_odb_object_free(@as(*c.git_odb_object, @ptrCast(self)));
+    }
+
+    /// The uncompressed, raw data as read from the database, valid until `deinit`.
+    pub fn data(self: *OdbObject) []const u8 {
+        const ptr: [*]const u8 = @ptrCast(c.git_odb_object_data(@as(*c.git_odb_object, @ptrCast(self))).?);
+        return ptr[0..c.git_odb_object_size(@as(*c.git_odb_object, @ptrCast(self)))];
+    }
+
+    pub fn objectType(self: *OdbObject) git.ObjectType {
+        return @as(git.ObjectType, @enumFromInt(c.git_odb_object_type(@as(*c.git_odb_object, @ptrCast(self)))));
+    }
+
     comptime {
         std.testing.refAllDecls(@This());
     }